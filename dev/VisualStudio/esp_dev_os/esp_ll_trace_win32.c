@@ -0,0 +1,99 @@
+/**
+ * \file            esp_ll_trace_win32.c
+ * \brief           Library WIN32 low-level driver with AT command trace
+ */
+
+/*
+ * Library driver is compiled as part of this file, not copied.
+ * Its initialization functions are renamed and wrapped:
+ *
+ *  - Send function set by library driver is replaced with function
+ *      which passes data to cmd_trace_tx first and calls library one after
+ *  - Calls of esp_input_process and esp_input from driver receive thread
+ *      pass data to cmd_trace_rx before they reach the library
+ *
+ * Use cmd_trace_dump to print collected statistics.
+ */
+#include "system/esp_ll.h"
+#include "esp/esp.h"
+#include "esp/esp_input.h"
+#include "cmd_trace.h"
+
+#if !__DOXYGEN__
+
+static esp_ll_send_fn esp_ll_lib_send;
+
+/**
+ * \brief           Trace received data and pass them to library
+ * \param[in]       data: Received data
+ * \param[in]       len: Length of data in units of bytes
+ * \return          Result of library input function
+ */
+static espr_t
+esp_ll_trace_input_process(const void* data, size_t len) {
+    cmd_trace_rx(data, len);
+    return esp_input_process(data, len);
+}
+
+/**
+ * \brief           Trace received data and pass them to library input buffer
+ * \param[in]       data: Received data
+ * \param[in]       len: Length of data in units of bytes
+ * \return          Result of library input function
+ */
+static espr_t
+esp_ll_trace_input(const void* data, size_t len) {
+    cmd_trace_rx(data, len);
+    return esp_input(data, len);
+}
+
+/* Rename driver entry points and redirect its input calls to trace */
+#define esp_input_process               esp_ll_trace_input_process
+#define esp_input                       esp_ll_trace_input
+#define esp_ll_init                     esp_ll_win32_init
+#define esp_ll_deinit                   esp_ll_win32_deinit
+#include "../../../ESP_AT_Lib/src/system/esp_ll_win32.c"
+#undef esp_input_process
+#undef esp_input
+#undef esp_ll_init
+#undef esp_ll_deinit
+
+/**
+ * \brief           Trace sent data and send them with library driver
+ * \param[in]       data: Pointer to data to send
+ * \param[in]       len: Number of bytes to send
+ * \return          Number of bytes sent
+ */
+static size_t
+esp_ll_trace_send(const void* data, size_t len) {
+    cmd_trace_tx(data, len);
+    return esp_ll_lib_send(data, len);
+}
+
+/**
+ * \brief           Callback function called from initialization process
+ * \param[in,out]   ll: Pointer to \ref esp_ll_t structure to fill data for communication functions
+ * \return          espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_ll_init(esp_ll_t* ll) {
+    espr_t res;
+
+    if ((res = esp_ll_win32_init(ll)) == espOK && ll->send_fn != esp_ll_trace_send) {
+        esp_ll_lib_send = ll->send_fn;          /* Wrap send function set by library driver */
+        ll->send_fn = esp_ll_trace_send;
+    }
+    return res;
+}
+
+/**
+ * \brief           Callback function to de-init low-level communication part
+ * \param[in,out]   ll: Pointer to \ref esp_ll_t structure to fill data for communication functions
+ * \return          espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_ll_deinit(esp_ll_t* ll) {
+    return esp_ll_win32_deinit(ll);
+}
+
+#endif /* !__DOXYGEN__ */
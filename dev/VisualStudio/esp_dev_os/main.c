@@ -14,6 +14,18 @@
 #include "netconn_client.h"
 #include "netconn_server.h"
 #include "netconn_server_1thread.h"
+#include "conn_select.h"
+#include "conn_async.h"
+#include "netconn_udp_batch.h"
+#include "netconn_client_pool.h"
+#include "conn_select_bench.h"
+#include "pbuf_chain.h"
+#include "pbuf_util.h"
+#include "cmd_lanes.h"
+#include "cmd_bench.h"
+#include "cmd_future.h"
+#include "evt_mux.h"
+#include "cmd_trace.h"
 #include "string.h"
 
 static void main_thread(void* arg);
@@ -102,11 +114,29 @@ main_thread(void* arg) {
         //    esp_delay(2000);
     //}
 
+    /* Print latency of AT commands sent so far, traced by esp_ll_trace_win32.c */
+    //cmd_trace_dump();
+
+    /* Compare esp_pbuf_cat and pbuf chain head with 1000 segments */
+    //pbuf_chain_benchmark(1000, 64);
+
+    /* Print memory used by pbuf header for small and full +IPD blocks */
+    //pbuf_util_overhead_print();
+
     /* Start server on port 80 */
     //http_server_start();
     //esp_sys_thread_create(NULL, "netconn_client", (esp_sys_thread_fn)netconn_client_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
     //esp_sys_thread_create(NULL, "netconn_server", (esp_sys_thread_fn)netconn_server_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
     //esp_sys_thread_create(NULL, "netconn_server_single", (esp_sys_thread_fn)netconn_server_1thread_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "conn_select_server", (esp_sys_thread_fn)conn_select_server_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "conn_async", (esp_sys_thread_fn)conn_async_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "netconn_udp_batch", (esp_sys_thread_fn)netconn_udp_batch_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "netconn_client_pool", (esp_sys_thread_fn)netconn_client_pool_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "conn_select_bench", (esp_sys_thread_fn)conn_select_bench_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "cmd_lanes", (esp_sys_thread_fn)cmd_lanes_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "cmd_bench", (esp_sys_thread_fn)cmd_bench_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "cmd_future", (esp_sys_thread_fn)cmd_future_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
+    //esp_sys_thread_create(NULL, "evt_mux_deferred", (esp_sys_thread_fn)evt_mux_deferred_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
     //esp_sys_thread_create(NULL, "mqtt_client", (esp_sys_thread_fn)mqtt_client_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
     //esp_sys_thread_create(NULL, "mqtt_client_api", (esp_sys_thread_fn)mqtt_client_api_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
     esp_sys_thread_create(NULL, "mqtt_client_api_cayenne", (esp_sys_thread_fn)mqtt_client_api_cayenne_thread, NULL, 0, ESP_SYS_THREAD_PRIO);
@@ -57,6 +57,38 @@
  *  <tr><td>Block 3         <td>NULL                <td>270             <td>270                 <td>1                   </tr>
  * </table>
  *
+ * \section         sect_pbuf_memory Memory usage
+ *
+ * Every pbuf is allocated with single call to memory manager.
+ * Header structure and payload are placed in the same block, payload follows header directly,
+ * therefore there is no separate allocation for data part.
+ *
+ * When data are received from device (`+IPD` statement), size of new pbuf is set to
+ * the lower of remaining `+IPD` length and \ref ESP_CFG_IPD_MAX_BUFF_SIZE.
+ * Small packets, such as `2` bytes of telnet keystroke, allocate header and `2` bytes of payload only.
+ * \ref ESP_CFG_IPD_MAX_BUFF_SIZE limits size of single block for large packets,
+ * which are in this case split to multiple pbufs and linked to chain.
+ *
+ * \note            Memory manager adds its own block header to every allocation.
+ *                  Lowering \ref ESP_CFG_IPD_MAX_BUFF_SIZE does not save memory for small packets,
+ *                  it only limits largest continuous block, which may help with fragmented memory.
+ *
+ * Overhead of single pbuf is pbuf header plus memory manager block header and alignment.
+ * Table below is computed from structure sizes for `32-bit` target with `4-byte` alignment.
+ * It is not measured, call `pbuf_util_overhead_print` from snippets on the target to get actual numbers.
+ *
+ * <table>
+ *  <tr><th>Payload                         <th>Overhead    <th>Overhead vs payload </tr>
+ *  <tr><td>`2` bytes, telnet keystroke     <td>~`40` bytes <td>~`2000%`            </tr>
+ *  <tr><td>`64` bytes, small MQTT packet   <td>~`40` bytes <td>~`60%`              </tr>
+ *  <tr><td>\ref ESP_CFG_IPD_MAX_BUFF_SIZE  <td>~`40` bytes <td>under `3%`          </tr>
+ * </table>
+ *
+ * \note            Payload is already right-sized to `+IPD` length and placed in the same block as header.
+ *                  Inline pbufs from dedicated fixed-size pool would only remove memory manager block header
+ *                  for small packets. It requires changes in pbuf allocation of the library itself,
+ *                  it cannot be done by application code.
+ *
  * \section        	sect_pbuf_concat_chain Concatenating vs chaining
  *
  * When we are dealing with application part, it is important to know what is the difference between \ref esp_pbuf_cat and \ref esp_pbuf_chain.
@@ -33,6 +33,7 @@
 
 #include "esp/esp.h"
 #include "station_manager.h"
+#include "device_state.h"
 #include "netconn_server.h"
 
 static void LL_Init(void);
@@ -77,12 +78,15 @@ init_thread(void const* arg) {
         printf("ESP-AT Lib initialized!\r\n");
     }
 
+    /* Keep cached station status, updated from events, for cheap polling */
+    device_state_init();
+
     /*
      * Continuously try to connect to WIFI network
      * but only in case device is not already connected
      */
     while (1) {
-        if (!esp_sta_is_joined()) {
+        if (!device_state_is_joined()) {
             /*
              * Connect to access point.
              *
@@ -33,6 +33,7 @@
 
 #include "esp/esp.h"
 #include "station_manager.h"
+#include "device_state.h"
 #include "netconn_client.h"
 
 static void LL_Init(void);
@@ -78,9 +79,12 @@ init_thread(void const* arg) {
         printf("ESP-AT Lib initialized!\r\n");
     }
 
+    /* Keep cached station status, updated from events, for cheap polling */
+    device_state_init();
+
     while (1) {
         /* Periodically check if device connected to network */
-        if (!esp_sta_is_joined()) {
+        if (!device_state_is_joined()) {
             /*
              * Connect to access point.
              *
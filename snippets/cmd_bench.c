@@ -0,0 +1,240 @@
+/*
+ * Command round-trip benchmark measures cost of passing command
+ * from user thread through producer and process threads and back.
+ *
+ * Same cheap command is executed in blocking mode, where user thread waits
+ * for library semaphore, and in non-blocking mode, where result is reported
+ * by callback from library thread and user thread is woken up by its own semaphore.
+ *
+ * Thread handoff takes microseconds, while esp_sys_now has resolution of 1 ms or worse,
+ * so commands are timed with high-resolution counter from cmd_bench_now_us.
+ *
+ * When AT command trace is enabled, time spent on AT port by benchmark commands
+ * is subtracted from round-trip time. Remaining time is thread handoff overhead.
+ *
+ * Single-thread event loop mode is blocked on library core: it would replace
+ * producer and process threads in esp_threads.c of ESP_AT_Lib submodule,
+ * which is not part of this tree, and cannot be implemented with public API.
+ * Numbers printed here are baseline for that change:
+ *
+ *  - Thread handoff time is upper bound of latency single thread could save
+ *  - RAM estimate is process thread stack and process message queue,
+ *      which single thread would not need. It is computed from configuration, not measured
+ */
+#include "cmd_bench.h"
+#include "esp/esp_mem.h"
+#if defined(_WIN32)
+#include <windows.h>
+#endif /* defined(_WIN32) */
+#if CMD_BENCH_TRACE
+#include "cmd_trace.h"
+#endif /* CMD_BENCH_TRACE */
+
+/**
+ * \brief           Latency measurement of single benchmark phase
+ */
+typedef struct {
+    uint32_t min;                               /*!< Minimal latency in units of microseconds */
+    uint32_t max;                               /*!< Maximal latency in units of microseconds */
+    uint32_t total;                             /*!< Sum of latencies in units of microseconds */
+    uint32_t cnt;                               /*!< Number of successful commands */
+    uint32_t errors;                            /*!< Number of failed commands */
+} cmd_bench_result_t;
+
+/**
+ * \brief           Non-blocking command context
+ */
+typedef struct {
+    esp_sys_sem_t sem;                          /*!< Released from callback */
+    uint32_t start;                             /*!< Time when command was started */
+    uint32_t cb_time;                           /*!< Time when callback was called */
+    size_t mem_min;                             /*!< Minimal free memory seen in callback */
+    espr_t res;                                 /*!< Command result */
+} cmd_bench_ctx_t;
+
+/**
+ * \brief           Hostname buffer, written by benchmark command
+ */
+static char
+cmd_bench_hostname[32];
+
+/**
+ * \brief           Add latency to result
+ * \param[in]       r: Result handle
+ * \param[in]       res: Command result
+ * \param[in]       v: Latency in units of microseconds
+ */
+static void
+cmd_bench_add(cmd_bench_result_t* r, espr_t res, uint32_t v) {
+    if (res != espOK) {
+        r->errors++;
+        return;
+    }
+    if (r->cnt == 0 || v < r->min) {
+        r->min = v;
+    }
+    if (v > r->max) {
+        r->max = v;
+    }
+    r->total += v;
+    r->cnt++;
+}
+
+/**
+ * \brief           Print result of benchmark phase
+ * \param[in]       name: Phase name
+ * \param[in]       r: Result handle
+ */
+static void
+cmd_bench_print(const char* name, const cmd_bench_result_t* r) {
+    printf("%-20s: %d cmds, %d errors, min %d avg %d max %d us\r\n", name,
+        (int)r->cnt, (int)r->errors, (int)r->min,
+        (int)(r->cnt ? r->total / r->cnt : 0), (int)r->max);
+}
+
+#if CMD_BENCH_TRACE
+
+/**
+ * \brief           Print average time per command not spent on AT port
+ *
+ *                  Only commands issued by benchmark are counted,
+ *                  commands started by library itself during phase are ignored
+ *
+ * \param[in]       name: Phase name
+ * \param[in]       r: Result of phase
+ */
+static void
+cmd_bench_print_overhead(const char* name, const cmd_bench_result_t* r) {
+    cmd_trace_stats_t st;
+    uint32_t exec;
+
+    for (size_t i = 0; i <= CMD_TRACE_TYPES; i++) {
+        if (cmd_trace_get_stats(i, &st) && !strcmp(st.name, CMD_BENCH_TRACE_NAME)) {
+            break;
+        }
+        st.count = 0;
+    }
+    if (r->cnt > 0 && st.count > 0) {
+        exec = cmd_trace_hist_avg(&st.exec, st.count);
+        printf("%-20s: AT port %d us/cmd, thread handoff %d us/cmd\r\n", name,
+            (int)exec, (int)(r->total / r->cnt > exec ? r->total / r->cnt - exec : 0));
+    }
+}
+
+#endif /* CMD_BENCH_TRACE */
+
+/**
+ * \brief           Get current time from high-resolution counter
+ *
+ *                  Win32 uses performance counter. Other platforms use \ref CMD_BENCH_CYCLES
+ *                  counter when it is defined, for example cycle counter of Cortex-M core,
+ *                  and fall back to \ref esp_sys_now otherwise
+ *
+ * \return          Time in units of microseconds
+ */
+uint32_t
+cmd_bench_now_us(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER cnt;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&cnt);
+    return (uint32_t)((cnt.QuadPart / freq.QuadPart) * 1000000
+        + (cnt.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);  /* Split to avoid overflow */
+#elif defined(CMD_BENCH_CYCLES)
+    return (uint32_t)(CMD_BENCH_CYCLES() / CMD_BENCH_CYCLES_PER_US);
+#else
+    return esp_sys_now() * 1000;                /* Resolution of 1 ms only */
+#endif
+}
+
+/**
+ * \brief           Callback for non-blocking command
+ * \param[in]       res: Command result
+ * \param[in]       arg: Command context
+ */
+static void
+cmd_bench_done(espr_t res, void* arg) {
+    cmd_bench_ctx_t* ctx = arg;
+
+    ctx->cb_time = cmd_bench_now_us();
+    ctx->mem_min = ESP_MIN(ctx->mem_min, esp_mem_getfree());    /* Command memory is still allocated */
+    ctx->res = res;
+    esp_sys_sem_release(&ctx->sem);
+}
+
+/**
+ * \brief           Command round-trip benchmark thread
+ * \param[in]       arg: User argument
+ */
+void
+cmd_bench_thread(void const* arg) {
+    cmd_bench_result_t blocking, callback, wakeup;
+    cmd_bench_ctx_t ctx;
+    size_t mem_before;
+    uint32_t start;
+    espr_t res;
+
+    ESP_UNUSED(arg);
+    memset(&blocking, 0x00, sizeof(blocking));
+    memset(&callback, 0x00, sizeof(callback));
+    memset(&wakeup, 0x00, sizeof(wakeup));
+    if (!esp_sys_sem_create(&ctx.sem, 0)) {
+        printf("Cannot create semaphore!\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    mem_before = esp_mem_getfree();
+    ctx.mem_min = mem_before;
+
+    /* Blocking mode: user thread waits for library to release command semaphore */
+#if CMD_BENCH_TRACE
+    cmd_trace_reset();
+#endif /* CMD_BENCH_TRACE */
+    for (size_t i = 0; i < CMD_BENCH_ITERATIONS; i++) {
+        start = cmd_bench_now_us();
+        res = esp_hostname_get(cmd_bench_hostname, sizeof(cmd_bench_hostname), NULL, NULL, 1);
+        cmd_bench_add(&blocking, res, cmd_bench_now_us() - start);
+    }
+    cmd_bench_print("Blocking", &blocking);
+#if CMD_BENCH_TRACE
+    cmd_bench_print_overhead("Blocking", &blocking);
+#endif /* CMD_BENCH_TRACE */
+
+    /* Non-blocking mode: result is reported from library thread */
+#if CMD_BENCH_TRACE
+    cmd_trace_reset();
+#endif /* CMD_BENCH_TRACE */
+    for (size_t i = 0; i < CMD_BENCH_ITERATIONS; i++) {
+        ctx.start = cmd_bench_now_us();
+        res = esp_hostname_get(cmd_bench_hostname, sizeof(cmd_bench_hostname), cmd_bench_done, &ctx, 0);
+        if (res == espOK) {
+            esp_sys_sem_wait(&ctx.sem, 0);
+            res = ctx.res;
+        }
+        cmd_bench_add(&callback, res, ctx.cb_time - ctx.start);
+        cmd_bench_add(&wakeup, res, cmd_bench_now_us() - ctx.start);
+    }
+    cmd_bench_print("Callback", &callback);
+    cmd_bench_print("Callback + wakeup", &wakeup);
+#if CMD_BENCH_TRACE
+    cmd_bench_print_overhead("Callback", &callback);
+#endif /* CMD_BENCH_TRACE */
+
+    /*
+     * Stack sizes are configured values passed to esp_sys_thread_create,
+     * not measured usage. Single-thread design would save one of them
+     */
+    printf("Heap: free before %d, free now %d, minimal free during command %d bytes\r\n",
+        (int)mem_before, (int)esp_mem_getfree(), (int)ctx.mem_min);
+    printf("Mode: producer and process threads, configured stacks: producer %d, process %d bytes\r\n",
+        (int)ESP_SYS_THREAD_SS, (int)ESP_SYS_THREAD_SS);
+    printf("Single thread would save: process stack %d bytes, process queue %d bytes (estimate)\r\n",
+        (int)ESP_SYS_THREAD_SS, (int)(ESP_CFG_THREAD_PROCESS_MBOX_SIZE * sizeof(void *)));
+
+    esp_sys_sem_delete(&ctx.sem);
+    esp_sys_thread_terminate(NULL);
+}
@@ -0,0 +1,252 @@
+/*
+ * Command futures are completion objects for non-blocking API calls.
+ *
+ * Future is passed to API function instead of callback and argument pair,
+ * library marks it as finished from its own thread once command is processed.
+ * User thread may start multiple commands and then poll them,
+ * wait for any of them or wait for all of them, without extra threads.
+ *
+ * Waiting thread registers its own semaphore to all futures it waits for,
+ * completion releases it and waiting thread checks all futures again.
+ */
+#include "cmd_future.h"
+
+/**
+ * \brief           Initialize future before it is passed to API function
+ * \param[in]       f: Future handle
+ */
+void
+cmd_future_init(cmd_future_t* f) {
+    f->done = 0;
+    f->res = espINPROG;
+    f->notify = NULL;
+}
+
+/**
+ * \brief           Command finished callback, passed to API function with future as argument
+ * \note            Use \ref CMD_FUTURE_CB macro to pass callback and future
+ * \param[in]       res: Command result
+ * \param[in]       arg: Future handle
+ */
+void
+cmd_future_cb(espr_t res, void* arg) {
+    cmd_future_t* f = arg;
+
+    esp_sys_protect();
+    f->res = res;
+    f->done = 1;
+    if (f->notify != NULL) {
+        esp_sys_sem_release(f->notify);         /* Wake up waiting thread */
+    }
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Check result of API function call
+ *
+ *                  When command could not be queued, callback is never called.
+ *                  Future is finished immediately with returned error in this case
+ *
+ * \param[in]       f: Future handle
+ * \param[in]       res: Result returned by non-blocking API function
+ */
+void
+cmd_future_start(cmd_future_t* f, espr_t res) {
+    if (res != espOK) {
+        cmd_future_cb(res, f);
+    }
+}
+
+/**
+ * \brief           Check if command is finished, without waiting
+ * \param[in]       f: Future handle
+ * \param[out]      res: Optional output variable to save command result to
+ * \return          `1` if command is finished, `0` otherwise
+ */
+uint8_t
+cmd_future_poll(cmd_future_t* f, espr_t* res) {
+    uint8_t done;
+
+    esp_sys_protect();
+    done = f->done;
+    if (done && res != NULL) {
+        *res = f->res;
+    }
+    esp_sys_unprotect();
+    return done;
+}
+
+/**
+ * \brief           Wait for any or all futures to finish
+ * \param[in]       f: Array of futures
+ * \param[in]       cnt: Number of futures in array
+ * \param[in]       all: Set to `1` to wait for all futures, `0` to wait for any of them
+ * \param[out]      index: Optional output variable to save index of first finished future to
+ * \param[in]       timeout: Maximal time to wait in units of milliseconds. Set to `0` to wait forever
+ * \return          \ref espOK on success, \ref espTIMEOUT on timeout, member of \ref espr_t otherwise
+ */
+static espr_t
+cmd_future_wait_cond(cmd_future_t* const* f, size_t cnt, uint8_t all, size_t* index, uint32_t timeout) {
+    esp_sys_sem_t sem;
+    uint32_t start, elapsed;
+    size_t i, done, first;
+    espr_t res = espTIMEOUT;
+
+    if (!esp_sys_sem_create(&sem, 0)) {
+        return espERRMEM;
+    }
+    start = esp_sys_now();
+    while (1) {
+        esp_sys_protect();
+        done = 0;
+        first = cnt;
+        for (i = 0; i < cnt; i++) {
+            if (f[i]->done) {
+                if (first == cnt) {
+                    first = i;
+                }
+                done++;
+            }
+            f[i]->notify = &sem;
+        }
+        if (all ? done == cnt : first < cnt) {
+            res = espOK;
+        }
+        elapsed = esp_sys_now() - start;
+        if (res == espOK || (timeout > 0 && elapsed >= timeout)) {
+            for (i = 0; i < cnt; i++) {         /* Semaphore is deleted after return */
+                f[i]->notify = NULL;
+            }
+        }
+        esp_sys_unprotect();
+
+        if (res == espOK) {
+            if (index != NULL) {
+                *index = first;
+            }
+            break;
+        } else if (timeout > 0 && elapsed >= timeout) {
+            break;
+        }
+        esp_sys_sem_wait(&sem, timeout > 0 ? timeout - elapsed : 0);
+    }
+    esp_sys_sem_delete(&sem);
+    return res;
+}
+
+/**
+ * \brief           Wait for command to finish
+ * \param[in]       f: Future handle
+ * \param[in]       timeout: Maximal time to wait in units of milliseconds. Set to `0` to wait forever
+ * \return          Command result on success, \ref espTIMEOUT if command is not finished before timeout
+ */
+espr_t
+cmd_future_wait(cmd_future_t* f, uint32_t timeout) {
+    espr_t res;
+
+    if ((res = cmd_future_wait_cond(&f, 1, 1, NULL, timeout)) == espOK) {
+        res = f->res;
+    }
+    return res;
+}
+
+/**
+ * \brief           Wait for any of commands to finish
+ *
+ *                  When more commands are finished, lowest index is returned.
+ *                  Remove finished future from array before next call
+ *
+ * \param[in]       f: Array of futures
+ * \param[in]       cnt: Number of futures in array
+ * \param[out]      index: Output variable to save index of finished future to
+ * \param[in]       timeout: Maximal time to wait in units of milliseconds. Set to `0` to wait forever
+ * \return          \ref espOK if one command is finished, \ref espTIMEOUT on timeout,
+ *                      member of \ref espr_t otherwise
+ */
+espr_t
+cmd_future_wait_any(cmd_future_t* const* f, size_t cnt, size_t* index, uint32_t timeout) {
+    if (cnt == 0 || index == NULL) {
+        return espPARERR;
+    }
+    return cmd_future_wait_cond(f, cnt, 0, index, timeout);
+}
+
+/**
+ * \brief           Wait for all commands to finish
+ * \note            Result of every command must be checked separately
+ * \param[in]       f: Array of futures
+ * \param[in]       cnt: Number of futures in array
+ * \param[in]       timeout: Maximal time to wait in units of milliseconds. Set to `0` to wait forever
+ * \return          \ref espOK if all commands are finished, \ref espTIMEOUT on timeout,
+ *                      member of \ref espr_t otherwise
+ */
+espr_t
+cmd_future_wait_all(cmd_future_t* const* f, size_t cnt, uint32_t timeout) {
+    return cmd_future_wait_cond(f, cnt, 1, NULL, timeout);
+}
+
+/**
+ * \brief           Command futures example thread
+ *
+ *                  DNS, ping and SNTP queries are started at the same time,
+ *                  thread reports each result as soon as it is available
+ *
+ * \param[in]       arg: User argument
+ */
+void
+cmd_future_thread(void const* arg) {
+    static const char* names[] = { "DNS", "Ping", "SNTP" };
+    cmd_future_t dns, ping, sntp;
+    cmd_future_t* f[] = { &dns, &ping, &sntp };
+    cmd_future_t* pending[ESP_ARRAYSIZE(f)];
+    size_t pending_cnt, index;
+    esp_datetime_t dt;
+    uint32_t ping_time;
+    esp_ip_t ip;
+    espr_t res;
+
+    ESP_UNUSED(arg);
+    for (size_t i = 0; i < ESP_ARRAYSIZE(f); i++) {
+        cmd_future_init(f[i]);
+        pending[i] = f[i];
+    }
+    pending_cnt = ESP_ARRAYSIZE(f);
+
+    /* Start all commands without waiting */
+    cmd_future_start(&dns, esp_dns_gethostbyname("example.com", &ip, CMD_FUTURE_CB(&dns), 0));
+    cmd_future_start(&ping, esp_ping("example.com", &ping_time, CMD_FUTURE_CB(&ping), 0));
+    cmd_future_start(&sntp, esp_sntp_gettime(&dt, CMD_FUTURE_CB(&sntp), 0));
+
+    /* Report results in order of completion */
+    while (pending_cnt > 0 && cmd_future_wait_any(pending, pending_cnt, &index, 30000) == espOK) {
+        cmd_future_poll(pending[index], &res);
+        for (size_t i = 0; i < ESP_ARRAYSIZE(f); i++) {
+            if (f[i] == pending[index]) {
+                printf("%s finished with result: %d\r\n", names[i], (int)res);
+            }
+        }
+        pending[index] = pending[--pending_cnt];/* Remove finished future */
+    }
+
+    if (cmd_future_wait_all(f, ESP_ARRAYSIZE(f), 1) == espOK) {
+        if (dns.res == espOK) {
+            printf("IP: %d.%d.%d.%d\r\n", (int)ip.ip[0], (int)ip.ip[1], (int)ip.ip[2], (int)ip.ip[3]);
+        }
+        if (ping.res == espOK) {
+            printf("Ping time: %d ms\r\n", (int)ping_time);
+        }
+        if (sntp.res == espOK) {
+            printf("Date and time: %d.%d.%d: %d:%d:%d\r\n",
+                (int)dt.date, (int)dt.month, (int)dt.year,
+                (int)dt.hours, (int)dt.minutes, (int)dt.seconds);
+        }
+    } else {
+        /*
+         * Commands still in progress reference local variables,
+         * thread must not exit before they finish
+         */
+        printf("Commands did not finish, waiting...\r\n");
+        cmd_future_wait_all(f, ESP_ARRAYSIZE(f), 0);
+    }
+    esp_sys_thread_terminate(NULL);
+}
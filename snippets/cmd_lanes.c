@@ -0,0 +1,488 @@
+/*
+ * Command lanes put blocking API calls from different user threads
+ * to priority queues, executed one by one from single dispatcher thread.
+ *
+ * Scope: lanes do NOT remove stall caused by running slow command.
+ * Library producer thread executes commands in single FIFO, one at a time.
+ * Once access point scan is passed to the library, every data send waits
+ * for it to finish, in lane or in library queue, for full duration of the scan.
+ * Removing that stall requires preemption or second queue in library core,
+ * which is not part of this tree.
+ *
+ * What lanes do:
+ *
+ *  - Order commands still waiting: dispatcher passes one command at a time
+ *      and always selects it from highest priority non-empty lane,
+ *      slow management command therefore only starts when data lane is empty
+ *  - Bound wait time: command waiting longer than maximal wait time of its lane is executed first
+ *  - Bound depth: full lane rejects command immediately instead of blocking the caller
+ *  - Measure: per-lane depth and wait time statistics show when interactive traffic stalls,
+ *      including stalls behind running scan
+ *
+ * Every call costs one extra thread handoff to dispatcher.
+ *
+ * Command may have deadline and cancellation token. Command whose deadline passed
+ * or whose token was cancelled is dropped before it is passed to the library,
+ * so no AT port time is spent on results nobody waits for.
+ * Command already passed to the library cannot be cancelled and is always finished.
+ */
+#include "cmd_lanes.h"
+#if CMD_LANES_TRACE
+#include "cmd_trace.h"
+#endif /* CMD_LANES_TRACE */
+
+/**
+ * \brief           Remove waiting command from its lane
+ * \note            Function must be called with system protection
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       c: Command to remove
+ * \return          `1` if command was removed, `0` if it is not in lane anymore
+ */
+static uint8_t
+cmd_lanes_unlink(cmd_lanes_t* cl, cmd_lanes_cmd_t* c) {
+    cmd_lanes_lane_t* l = &cl->lanes[c->lane];
+    cmd_lanes_cmd_t* prev = NULL;
+
+    for (cmd_lanes_cmd_t* it = l->head; it != NULL; prev = it, it = it->next) {
+        if (it == c) {
+            if (prev != NULL) {
+                prev->next = c->next;
+            } else {
+                l->head = c->next;
+            }
+            if (l->tail == c) {
+                l->tail = prev;
+            }
+            c->next = NULL;
+            l->stats.depth--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief           Check if command shall be dropped instead of executed
+ * \note            Function must be called with system protection
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       c: Command to check
+ * \param[in]       now: Current time
+ * \return          `1` if command was dropped and its caller released, `0` otherwise
+ */
+static uint8_t
+cmd_lanes_drop_stale(cmd_lanes_t* cl, cmd_lanes_cmd_t* c, uint32_t now) {
+    cmd_lanes_stats_t* st = &cl->lanes[c->lane].stats;
+
+    if (c->token != NULL && c->token->cancelled) {
+        c->res = espCLOSED;
+        st->cancelled++;
+    } else if (c->timeout > 0 && (now - c->time) >= c->timeout) {
+        c->res = espTIMEOUT;
+        st->expired++;
+    } else {
+        return 0;
+    }
+    esp_sys_sem_release(&c->sem);               /* Command may not be used after this point */
+    return 1;
+}
+
+/**
+ * \brief           Take next command to execute
+ * \note            Function must be called with system protection
+ * \param[in]       cl: Command lanes handle
+ * \return          Command to execute or `NULL` if all lanes are empty
+ */
+static cmd_lanes_cmd_t*
+cmd_lanes_pop(cmd_lanes_t* cl) {
+    cmd_lanes_lane_t *l, *sel = NULL;
+    cmd_lanes_cmd_t* c;
+    uint32_t now;
+    size_t i;
+
+    /* Command waiting longer than allowed has precedence, oldest one first */
+    now = esp_sys_now();
+    for (i = 0; i < CMD_LANE_END; i++) {
+        l = &cl->lanes[i];
+        if (l->head != NULL && l->max_wait > 0 && (now - l->head->time) >= l->max_wait
+            && (sel == NULL || (now - l->head->time) > (now - sel->head->time))) {
+            sel = l;
+        }
+    }
+    if (sel != NULL) {
+        for (i = 0; &cl->lanes[i] != sel; i++) {
+            if (cl->lanes[i].head != NULL) {    /* Higher priority lane is waiting */
+                sel->stats.promoted++;
+                break;
+            }
+        }
+    } else {
+        /* Highest priority non-empty lane */
+        for (i = 0; i < CMD_LANE_END && sel == NULL; i++) {
+            if (cl->lanes[i].head != NULL) {
+                sel = &cl->lanes[i];
+            }
+        }
+        if (sel == NULL) {
+            return NULL;
+        }
+    }
+
+    c = sel->head;
+    sel->head = c->next;
+    if (sel->head == NULL) {
+        sel->tail = NULL;
+    }
+    c->next = NULL;
+    sel->stats.depth--;
+    return c;
+}
+
+/**
+ * \brief           Dispatcher thread, executing commands from lanes
+ * \param[in]       arg: Command lanes handle
+ */
+static void
+cmd_lanes_dispatcher(void* const arg) {
+    cmd_lanes_t* cl = arg;
+    cmd_lanes_stats_t* st;
+    cmd_lanes_cmd_t* c;
+    uint32_t wait;
+
+    while (1) {
+        esp_sys_protect();
+        do {
+            c = cmd_lanes_pop(cl);
+        } while (c != NULL && cmd_lanes_drop_stale(cl, c, esp_sys_now()));
+        if (c != NULL) {                        /* Count wait time of executed commands only */
+            st = &cl->lanes[c->lane].stats;
+            wait = esp_sys_now() - c->time;
+            st->wait_total += wait;
+            if (wait > st->wait_max) {
+                st->wait_max = wait;
+            }
+        }
+        esp_sys_unprotect();
+        if (c == NULL) {
+            esp_sys_sem_wait(&cl->work, 0);     /* Wait for new command */
+            continue;
+        }
+
+#if CMD_LANES_TRACE
+        cmd_trace_enqueue(c->trace_time);             /* Next AT command is measured from lane enqueue time */
+#endif /* CMD_LANES_TRACE */
+        c->res = c->fn(c->arg);                 /* Execute blocking command */
+
+        esp_sys_protect();
+        cl->lanes[c->lane].stats.executed++;
+        esp_sys_unprotect();
+        esp_sys_sem_release(&c->sem);           /* Command may not be used after this point */
+    }
+}
+
+/**
+ * \brief           Initialize command lanes and start dispatcher thread
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       stack_size: Stack size of dispatcher thread
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+cmd_lanes_init(cmd_lanes_t* cl, size_t stack_size) {
+    memset(cl, 0x00, sizeof(*cl));
+    cmd_lanes_set_policy(cl, CMD_LANE_DATA, CMD_LANES_DATA_DEPTH, 0);
+    cmd_lanes_set_policy(cl, CMD_LANE_CTRL, CMD_LANES_CTRL_DEPTH, CMD_LANES_CTRL_MAX_WAIT);
+    cmd_lanes_set_policy(cl, CMD_LANE_MGMT, CMD_LANES_MGMT_DEPTH, CMD_LANES_MGMT_MAX_WAIT);
+
+    if (!esp_sys_sem_create(&cl->work, 0)) {
+        esp_sys_sem_invalid(&cl->work);
+        return espERRMEM;
+    }
+    if (!esp_sys_thread_create(NULL, "cmd_lanes", (esp_sys_thread_fn)cmd_lanes_dispatcher, cl, stack_size, ESP_SYS_THREAD_PRIO)) {
+        esp_sys_sem_delete(&cl->work);
+        esp_sys_sem_invalid(&cl->work);
+        return espERRMEM;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Set maximal depth and maximal wait time of lane
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       lane: Lane to configure
+ * \param[in]       depth: Maximal number of commands waiting in lane
+ * \param[in]       max_wait: Time in units of milliseconds after which command is executed
+ *                      before commands from higher priority lanes. Set to `0` to disable
+ */
+void
+cmd_lanes_set_policy(cmd_lanes_t* cl, cmd_lane_t lane, size_t depth, uint32_t max_wait) {
+    if (lane < CMD_LANE_END) {
+        esp_sys_protect();
+        cl->lanes[lane].depth = depth;
+        cl->lanes[lane].max_wait = max_wait;
+        esp_sys_unprotect();
+    }
+}
+
+/**
+ * \brief           Execute command from dispatcher thread and wait for its result
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       lane: Lane to put command to
+ * \param[in]       fn: Command function
+ * \param[in]       arg: User argument for command function
+ * \return          Result of command function, \ref espERRMEM if lane is full
+ *                      or member of \ref espr_t otherwise
+ */
+espr_t
+cmd_lanes_call(cmd_lanes_t* cl, cmd_lane_t lane, cmd_lanes_fn fn, void* arg) {
+    return cmd_lanes_call_ex(cl, lane, fn, arg, 0, NULL);
+}
+
+/**
+ * \brief           Execute command from dispatcher thread with deadline and cancellation token
+ *
+ *                  When deadline passes or token is cancelled while command is waiting in lane,
+ *                  command is removed from lane and function returns immediately.
+ *                  Once command is passed to library, function waits for its result
+ *
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       lane: Lane to put command to
+ * \param[in]       fn: Command function
+ * \param[in]       arg: User argument for command function
+ * \param[in]       timeout: Maximal time in units of milliseconds command may wait in lane.
+ *                      Set to `0` to wait without limit
+ * \param[in]       token: Optional cancellation token, set to `NULL` if not used
+ * \return          Result of command function, \ref espERRMEM if lane is full,
+ *                      \ref espTIMEOUT if deadline passed, \ref espCLOSED if command was cancelled
+ *                      or member of \ref espr_t otherwise
+ */
+espr_t
+cmd_lanes_call_ex(cmd_lanes_t* cl, cmd_lane_t lane, cmd_lanes_fn fn, void* arg,
+                  uint32_t timeout, cmd_lanes_token_t* token) {
+    cmd_lanes_lane_t* l;
+    cmd_lanes_cmd_t c;
+    espr_t res = espOK;
+    uint8_t done = 0;
+
+    if (lane >= CMD_LANE_END || fn == NULL) {
+        return espPARERR;
+    }
+    memset(&c, 0x00, sizeof(c));
+    c.fn = fn;
+    c.arg = arg;
+    c.lane = lane;
+    c.timeout = timeout;
+    c.token = token;
+    if (!esp_sys_sem_create(&c.sem, 0)) {
+        return espERRMEM;
+    }
+
+    l = &cl->lanes[lane];
+    esp_sys_protect();
+    if (token != NULL && token->cancelled) {
+        l->stats.cancelled++;
+        res = espCLOSED;
+    } else if (l->stats.depth >= l->depth) {
+        l->stats.rejected++;
+        res = espERRMEM;
+    } else {
+        c.time = esp_sys_now();
+#if CMD_LANES_TRACE
+        c.trace_time = CMD_TRACE_NOW();
+#endif /* CMD_LANES_TRACE */
+        if (l->tail != NULL) {
+            l->tail->next = &c;
+        } else {
+            l->head = &c;
+        }
+        l->tail = &c;
+        l->stats.submitted++;
+        if (++l->stats.depth > l->stats.depth_max) {
+            l->stats.depth_max = l->stats.depth;
+        }
+    }
+    esp_sys_unprotect();
+
+    if (res == espOK) {
+        esp_sys_sem_release(&cl->work);         /* Wake up dispatcher */
+        if (timeout > 0) {
+            if (esp_sys_sem_wait(&c.sem, timeout) != ESP_SYS_TIMEOUT) {
+                done = 1;                       /* Command finished before deadline */
+            } else {
+                /* Deadline passed, drop command if it is still waiting in lane */
+                esp_sys_protect();
+                if (cmd_lanes_unlink(cl, &c)) {
+                    l->stats.expired++;
+                    c.res = espTIMEOUT;
+                    done = 1;
+                }
+                esp_sys_unprotect();
+            }
+        }
+        if (!done) {
+            esp_sys_sem_wait(&c.sem, 0);        /* Wait for command to finish */
+        }
+        res = c.res;
+    }
+    esp_sys_sem_delete(&c.sem);
+    return res;
+}
+
+/**
+ * \brief           Initialize cancellation token
+ * \param[in]       token: Token to initialize
+ */
+void
+cmd_lanes_token_init(cmd_lanes_token_t* token) {
+    token->cancelled = 0;
+}
+
+/**
+ * \brief           Cancel all waiting commands using token
+ *
+ *                  Cancelled commands are removed from lanes and their callers return \ref espCLOSED.
+ *                  New commands using cancelled token are not accepted until token is initialized again.
+ *                  Command already passed to library is not affected
+ *
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       token: Token to cancel
+ */
+void
+cmd_lanes_cancel(cmd_lanes_t* cl, cmd_lanes_token_t* token) {
+    cmd_lanes_cmd_t *c, *next;
+
+    esp_sys_protect();
+    token->cancelled = 1;
+    for (size_t i = 0; i < CMD_LANE_END; i++) {
+        for (c = cl->lanes[i].head; c != NULL; c = next) {
+            next = c->next;
+            if (c->token == token) {
+                cmd_lanes_unlink(cl, c);
+                cmd_lanes_drop_stale(cl, c, esp_sys_now());
+            }
+        }
+    }
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Get copy of lane statistics
+ * \param[in]       cl: Command lanes handle
+ * \param[in]       lane: Lane to get statistics for
+ * \param[out]      stats: Output variable to copy statistics to
+ */
+void
+cmd_lanes_get_stats(cmd_lanes_t* cl, cmd_lane_t lane, cmd_lanes_stats_t* stats) {
+    if (lane < CMD_LANE_END) {
+        esp_sys_protect();
+        *stats = cl->lanes[lane].stats;
+        esp_sys_unprotect();
+    }
+}
+
+/**
+ * \brief           Command lanes used by example
+ */
+static cmd_lanes_t
+lanes;
+
+/**
+ * \brief           Access points found by example scan
+ */
+static esp_ap_t
+aps[10];
+
+/**
+ * \brief           Example management command, scan for access points
+ * \param[in]       arg: Pointer to variable to save number of found access points to
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+cmd_lanes_example_scan(void* arg) {
+    return esp_sta_list_ap(NULL, aps, ESP_ARRAYSIZE(aps), arg, NULL, NULL, 1);
+}
+
+/**
+ * \brief           Example data command, send datagram
+ * \param[in]       arg: UDP netconn handle, connected to remote host
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+cmd_lanes_example_send(void* arg) {
+    static const char data[] = "cmd_lanes\r\n";
+
+    return esp_netconn_send(arg, data, sizeof(data) - 1);
+}
+
+/**
+ * \brief           Thread periodically scanning for access points in management lane
+ * \param[in]       arg: User argument
+ */
+static void
+cmd_lanes_scan_thread(void const* arg) {
+    size_t apf;
+    espr_t res;
+
+    ESP_UNUSED(arg);
+    while (1) {
+        res = cmd_lanes_call(&lanes, CMD_LANE_MGMT, cmd_lanes_example_scan, &apf);
+        if (res == espOK) {
+            printf("Scan found %d access points\r\n", (int)apf);
+        } else {
+            printf("Scan failed: %d\r\n", (int)res);
+        }
+        esp_delay(10000);
+    }
+}
+
+/**
+ * \brief           Command lanes example thread
+ *
+ *                  Thread sends datagram every 100 ms in data lane
+ *                  while separate thread scans for access points in management lane.
+ *                  Scan starts only when no datagram is waiting in lane,
+ *                  datagrams sent while scan is running wait until it finishes
+ *
+ * \param[in]       arg: User argument
+ */
+void
+cmd_lanes_thread(void const* arg) {
+    static const char* names[] = { "data", "ctrl", "mgmt" };
+    cmd_lanes_stats_t stats;
+    esp_netconn_p nc;
+    uint32_t i;
+    espr_t res;
+
+    ESP_UNUSED(arg);
+    if (cmd_lanes_init(&lanes, 512) != espOK
+        || (nc = esp_netconn_new(ESP_NETCONN_TYPE_UDP)) == NULL) {
+        printf("Cannot start command lanes!\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    /* UDP netconn must be connected to open link on device before it can send */
+    if ((res = esp_netconn_connect(nc, "192.168.0.14", 10000)) != espOK) {
+        printf("Cannot connect UDP netconn: %d\r\n", (int)res);
+        esp_netconn_delete(nc);
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    esp_sys_thread_create(NULL, "cmd_lanes_scan", (esp_sys_thread_fn)cmd_lanes_scan_thread, NULL, 512, ESP_SYS_THREAD_PRIO);
+
+    for (i = 1; ; i++) {
+        /* Datagram is useless if not sent within 1 second */
+        res = cmd_lanes_call_ex(&lanes, CMD_LANE_DATA, cmd_lanes_example_send, nc, 1000, NULL);
+        if (res != espOK) {
+            printf("Datagram %u failed: %d\r\n", (unsigned)i, (int)res);
+        }
+        esp_delay(100);
+
+        if ((i % 50) == 0) {                    /* Print statistics every 5 seconds */
+            for (size_t l = 0; l < CMD_LANE_END; l++) {
+                cmd_lanes_get_stats(&lanes, (cmd_lane_t)l, &stats);
+                printf("Lane %s: sub %u rej %u exe %u prom %u exp %u canc %u depth %u/%u wait avg %u max %u ms\r\n",
+                    names[l], (unsigned)stats.submitted, (unsigned)stats.rejected, (unsigned)stats.executed,
+                    (unsigned)stats.promoted, (unsigned)stats.expired, (unsigned)stats.cancelled, (unsigned)stats.depth, (unsigned)stats.depth_max,
+                    (unsigned)(stats.executed ? stats.wait_total / stats.executed : 0), (unsigned)stats.wait_max);
+            }
+        }
+    }
+}
@@ -0,0 +1,417 @@
+/*
+ * AT command trace measures latency of every AT command sent to device.
+ *
+ * Trace observes raw AT stream and must be fed from low-level layer:
+ *
+ *  - cmd_trace_tx with every block of data sent to AT port, from esp_ll send function
+ *  - cmd_trace_rx with every block of data received from AT port, before it is passed to esp_input_process
+ *
+ * Command starts with first byte of `AT` sent while no command is active
+ * or while active command has no payload, in which case active command was abandoned
+ * by library and is counted as error. Command finishes with final response:
+ * `OK`, `ERROR`, `FAIL`, or `SEND OK` and `SEND FAIL` for send commands.
+ * Data after `AT+CIPSEND` prompt, `+IPD` payload and `+CIPRECVDATA` payload
+ * of manual receive mode are never parsed as commands or responses.
+ *
+ * Optional cmd_trace_enqueue marks time when API call was queued,
+ * next command sent to device is measured from that time.
+ * Commands started by library itself are measured from first byte sent.
+ * Trace keeps single enqueue time, it is not tied to specific command.
+ * It is only correct when one thread, such as command lanes dispatcher, passes commands
+ * to the library one at a time; command started by library itself in between takes the time instead.
+ */
+#include <stdlib.h>
+#include "cmd_trace.h"
+
+#define CMD_TRACE_STATE_IDLE            0x00    /*!< No command is active */
+#define CMD_TRACE_STATE_NAME            0x01    /*!< Command name is being sent */
+#define CMD_TRACE_STATE_ACTIVE          0x02    /*!< Waiting for final response */
+
+/**
+ * \brief           Trace state and collected statistics
+ */
+static struct {
+    cmd_trace_stats_t types[CMD_TRACE_TYPES + 1];   /*!< Statistics per command type, last one is `OTHER` */
+    size_t types_cnt;                           /*!< Number of used command types */
+    cmd_trace_entry_t ring[CMD_TRACE_RING_LEN]; /*!< Last finished commands */
+    size_t ring_w;                              /*!< Next ring entry to write */
+    size_t ring_cnt;                            /*!< Number of valid ring entries */
+    uint32_t enqueue;                           /*!< Enqueue time for next command */
+    uint8_t enqueue_valid;                      /*!< Set to `1` when enqueue time is valid */
+
+    uint8_t state;                              /*!< Current command state */
+    uint8_t is_send;                            /*!< Set to `1` if current command sends data */
+    char name[CMD_TRACE_NAME_LEN + 3];          /*!< Current command name, including `AT+` */
+    size_t name_len;                            /*!< Length of current command name */
+    cmd_trace_entry_t cur;                      /*!< Current command */
+
+    char line[64];                              /*!< Currently received line */
+    size_t line_len;                            /*!< Length of currently received line */
+    size_t ipd_skip;                            /*!< Number of `+IPD` or `+CIPRECVDATA` payload bytes to skip */
+} trace = {
+    .types_cnt = 0,
+    .types[CMD_TRACE_TYPES].name = "OTHER",
+};
+
+/**
+ * \brief           Add latency to histogram
+ * \param[in]       h: Histogram handle
+ * \param[in]       first: Set to `1` for first latency in histogram
+ * \param[in]       v: Latency in units of \ref CMD_TRACE_NOW
+ */
+static void
+cmd_trace_hist_add(cmd_trace_hist_t* h, uint8_t first, uint32_t v) {
+    size_t i;
+
+    for (i = 0; i < CMD_TRACE_HIST_BUCKETS - 1 && v >= ((uint32_t)1 << i); i++) {}
+    h->hist[i]++;
+    h->total += v;
+    if (first || v < h->min) {
+        h->min = v;
+    }
+    if (v > h->max) {
+        h->max = v;
+    }
+}
+
+/**
+ * \brief           Get command type for current command name
+ * \return          Command type index
+ */
+static uint8_t
+cmd_trace_get_type(void) {
+    const char* name = trace.name;
+    size_t i;
+
+    if (!strncmp(name, "AT+", 3)) {
+        name += 3;
+    } else if (strcmp(name, "AT") && !strncmp(name, "AT", 2)) {
+        name += 2;
+    }
+    for (i = 0; i < trace.types_cnt; i++) {
+        if (!strcmp(trace.types[i].name, name)) {
+            return (uint8_t)i;
+        }
+    }
+    if (trace.types_cnt < CMD_TRACE_TYPES) {
+        strncpy(trace.types[i].name, name, CMD_TRACE_NAME_LEN - 1);
+        trace.types[i].name[CMD_TRACE_NAME_LEN - 1] = 0;
+        return (uint8_t)trace.types_cnt++;
+    }
+    return CMD_TRACE_TYPES;                     /* Table is full */
+}
+
+/**
+ * \brief           Finish current command
+ * \param[in]       ok: Set to `1` if command finished successfully
+ */
+static void
+cmd_trace_finish(uint8_t ok) {
+    cmd_trace_stats_t* st = &trace.types[trace.cur.type];
+
+    trace.cur.end = CMD_TRACE_NOW();
+    trace.cur.ok = ok;
+    cmd_trace_hist_add(&st->queue, st->count == 0, trace.cur.start - trace.cur.enqueue);
+    cmd_trace_hist_add(&st->exec, st->count == 0, trace.cur.end - trace.cur.start);
+    st->count++;
+    if (!ok) {
+        st->errors++;
+    }
+
+    trace.ring[trace.ring_w] = trace.cur;
+    trace.ring_w = (trace.ring_w + 1) % CMD_TRACE_RING_LEN;
+    if (trace.ring_cnt < CMD_TRACE_RING_LEN) {
+        trace.ring_cnt++;
+    }
+    trace.state = CMD_TRACE_STATE_IDLE;
+}
+
+/**
+ * \brief           Process single received line
+ */
+static void
+cmd_trace_process_line(void) {
+    const char* l = trace.line;
+
+    if (trace.state != CMD_TRACE_STATE_ACTIVE) {
+        return;
+    }
+    if (!strcmp(l, "SEND OK") || (!strcmp(l, "OK") && !trace.is_send)) {
+        cmd_trace_finish(1);
+    } else if (!strcmp(l, "ERROR") || !strcmp(l, "FAIL")
+        || !strcmp(l, "SEND FAIL") || !strcmp(l, "ready")) {
+        cmd_trace_finish(0);                    /* Error or device reset */
+    }
+}
+
+/**
+ * \brief           Get length of `+IPD` payload from received header
+ * \note            Header is `+IPD,len:` or `+IPD,conn,len[,ip,port]:`
+ * \return          Number of payload bytes
+ */
+static size_t
+cmd_trace_ipd_len(void) {
+    const char* p = &trace.line[5];
+    const char* comma;
+
+    comma = strchr(p, ',');
+    if (comma != NULL) {                        /* Skip connection number */
+        p = comma + 1;
+    }
+    return (size_t)strtoul(p, NULL, 10);
+}
+
+/**
+ * \brief           Get length of `+CIPRECVDATA` payload from received header
+ * \note            Header is `+CIPRECVDATA,len:` or `+CIPRECVDATA:len,`
+ * \param[in]       ch: Last received character
+ * \return          Number of payload bytes, `0` if header is not complete yet
+ */
+static size_t
+cmd_trace_recvdata_len(char ch) {
+    char sep = trace.line[12];
+
+    if ((sep == ',' && ch == ':') || (sep == ':' && ch == ',' && trace.line_len > 14)) {
+        return (size_t)strtoul(&trace.line[13], NULL, 10);
+    }
+    return 0;
+}
+
+/**
+ * \brief           Mark enqueue time of next command sent to device
+ *
+ *                  Time is used by next command sent to device, whichever it is.
+ *                  Call it only from single thread, right before blocking API call,
+ *                  calls from more threads overwrite each other
+ *
+ * \param[in]       time: Time when API call was queued, from \ref CMD_TRACE_NOW
+ */
+void
+cmd_trace_enqueue(uint32_t time) {
+    esp_sys_protect();
+    trace.enqueue = time;
+    trace.enqueue_valid = 1;
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Trace data sent to AT port
+ * \param[in]       data: Sent data
+ * \param[in]       len: Length of data in units of bytes
+ */
+void
+cmd_trace_tx(const void* data, size_t len) {
+    const uint8_t* d = data;
+    uint32_t now;
+    uint8_t ch;
+
+    esp_sys_protect();
+    now = CMD_TRACE_NOW();
+    for (size_t i = 0; i < len; i++) {
+        ch = d[i];
+        if (trace.state == CMD_TRACE_STATE_ACTIVE) {
+            if (!trace.is_send) {
+                if (ch != 'A') {
+                    continue;                   /* Line end after command name */
+                }
+                cmd_trace_finish(0);            /* Only send has payload, library abandoned command */
+            } else if (i == 0 && ch == 'A' && (now - trace.cur.start) >= CMD_TRACE_TIMEOUT) {
+                cmd_trace_finish(0);            /* Final response was never received */
+            } else {
+                break;                          /* Payload of active command */
+            }
+        }
+        if (trace.state == CMD_TRACE_STATE_IDLE) {
+            if (ch != 'A') {
+                continue;
+            }
+            memset(&trace.cur, 0x00, sizeof(trace.cur));
+            trace.cur.start = now;
+            trace.cur.enqueue = trace.enqueue_valid ? trace.enqueue : now;
+            trace.enqueue_valid = 0;
+            trace.name_len = 0;
+            trace.state = CMD_TRACE_STATE_NAME;
+        }
+        if (ch == '=' || ch == '?' || ch == '\r' || ch == '\n') {
+            trace.name[trace.name_len] = 0;
+            trace.cur.type = cmd_trace_get_type();
+            trace.is_send = !strncmp(trace.name, "AT+CIPSEND", 10);
+            trace.state = CMD_TRACE_STATE_ACTIVE;
+        } else if (trace.name_len < sizeof(trace.name) - 1) {
+            trace.name[trace.name_len++] = (char)ch;
+        }
+    }
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Trace data received from AT port
+ * \param[in]       data: Received data
+ * \param[in]       len: Length of data in units of bytes
+ */
+void
+cmd_trace_rx(const void* data, size_t len) {
+    const uint8_t* d = data;
+    size_t n;
+
+    esp_sys_protect();
+    for (size_t i = 0; i < len; i++) {
+        if (trace.ipd_skip > 0) {               /* Skip network data */
+            n = ESP_MIN(trace.ipd_skip, len - i);
+            trace.ipd_skip -= n;
+            i += n - 1;
+            continue;
+        }
+        if (d[i] == '\n') {
+            trace.line[trace.line_len] = 0;
+            cmd_trace_process_line();
+            trace.line_len = 0;
+        } else if (d[i] != '\r' && trace.line_len < sizeof(trace.line) - 1) {
+            trace.line[trace.line_len++] = (char)d[i];
+            trace.line[trace.line_len] = 0;
+            if (d[i] == ':' && !strncmp(trace.line, "+IPD,", 5)) {
+                trace.ipd_skip = cmd_trace_ipd_len();
+                trace.line_len = 0;
+            } else if (trace.line_len > 13 && !strncmp(trace.line, "+CIPRECVDATA", 12)
+                && (trace.ipd_skip = cmd_trace_recvdata_len((char)d[i])) > 0) {
+                trace.line_len = 0;
+            }
+        }
+    }
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Get copy of statistics for command type
+ * \param[in]       type: Command type index, from `0` to \ref CMD_TRACE_TYPES, last one is `OTHER`
+ * \param[out]      stats: Output variable to copy statistics to
+ * \return          `1` if command type is used, `0` otherwise
+ */
+uint8_t
+cmd_trace_get_stats(size_t type, cmd_trace_stats_t* stats) {
+    uint8_t ok = 0;
+
+    esp_sys_protect();
+    if (type < trace.types_cnt || (type == CMD_TRACE_TYPES && trace.types[type].count > 0)) {
+        *stats = trace.types[type];
+        ok = 1;
+    }
+    esp_sys_unprotect();
+    return ok;
+}
+
+/**
+ * \brief           Copy last finished commands from ring buffer
+ * \param[out]      entries: Array to copy commands to, oldest first
+ * \param[in]       cnt: Number of entries in array
+ * \return          Number of copied commands
+ */
+size_t
+cmd_trace_get_last(cmd_trace_entry_t* entries, size_t cnt) {
+    size_t i, r;
+
+    esp_sys_protect();
+    cnt = ESP_MIN(cnt, trace.ring_cnt);
+    r = (trace.ring_w + CMD_TRACE_RING_LEN - cnt) % CMD_TRACE_RING_LEN;
+    for (i = 0; i < cnt; i++) {
+        entries[i] = trace.ring[r];
+        r = (r + 1) % CMD_TRACE_RING_LEN;
+    }
+    esp_sys_unprotect();
+    return cnt;
+}
+
+/**
+ * \brief           Get average latency from histogram
+ * \param[in]       h: Histogram handle
+ * \param[in]       count: Number of latencies in histogram
+ * \return          Average latency in units of \ref CMD_TRACE_NOW
+ */
+uint32_t
+cmd_trace_hist_avg(const cmd_trace_hist_t* h, uint32_t count) {
+    return count > 0 ? h->total / count : 0;
+}
+
+/**
+ * \brief           Estimate latency percentile from histogram
+ *
+ *                  Result is upper bound of bucket containing percentile,
+ *                  but never larger than maximal latency
+ *
+ * \param[in]       h: Histogram handle
+ * \param[in]       count: Number of latencies in histogram
+ * \param[in]       pct: Percentile, from `1` to `100`
+ * \return          Latency in units of \ref CMD_TRACE_NOW
+ */
+uint32_t
+cmd_trace_hist_percentile(const cmd_trace_hist_t* h, uint32_t count, uint8_t pct) {
+    uint32_t target, sum = 0;
+    size_t i;
+
+    if (count == 0) {
+        return 0;
+    }
+    target = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+    for (i = 0; i < CMD_TRACE_HIST_BUCKETS - 1; i++) {
+        sum += h->hist[i];
+        if (sum >= target) {
+            return ESP_MIN(((uint32_t)1 << i) - 1, h->max);
+        }
+    }
+    return h->max;
+}
+
+/**
+ * \brief           Reset all statistics and trace ring buffer
+ */
+void
+cmd_trace_reset(void) {
+    esp_sys_protect();
+    memset(trace.types, 0x00, sizeof(trace.types));
+    strcpy(trace.types[CMD_TRACE_TYPES].name, "OTHER");
+    trace.types_cnt = 0;
+    trace.ring_w = 0;
+    trace.ring_cnt = 0;
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Print histogram summary
+ * \param[in]       name: Histogram name
+ * \param[in]       h: Histogram handle
+ * \param[in]       count: Number of latencies in histogram
+ */
+static void
+cmd_trace_print_hist(const char* name, const cmd_trace_hist_t* h, uint32_t count) {
+    printf(" %s min %d avg %d p99 %d max %d " CMD_TRACE_UNIT, name,
+        (int)h->min, (int)cmd_trace_hist_avg(h, count),
+        (int)cmd_trace_hist_percentile(h, count, 99), (int)h->max);
+}
+
+/**
+ * \brief           Print statistics of all command types and last commands
+ */
+void
+cmd_trace_dump(void) {
+    static cmd_trace_entry_t entries[CMD_TRACE_RING_LEN];
+    static cmd_trace_stats_t st, st_last;
+    size_t i, cnt;
+
+    for (i = 0; i <= CMD_TRACE_TYPES; i++) {
+        if (!cmd_trace_get_stats(i, &st) || st.count == 0) {
+            continue;
+        }
+        printf("%-11s: %d cmds, %d errors,", st.name, (int)st.count, (int)st.errors);
+        cmd_trace_print_hist("queue", &st.queue, st.count);
+        cmd_trace_print_hist(", exec", &st.exec, st.count);
+        printf("\r\n");
+    }
+
+    cnt = cmd_trace_get_last(entries, ESP_ARRAYSIZE(entries));
+    for (i = 0; i < cnt; i++) {
+        cmd_trace_get_stats(entries[i].type, &st_last);
+        printf("[%10u] %-11s queue %d " CMD_TRACE_UNIT ", exec %d " CMD_TRACE_UNIT ", %s\r\n", (unsigned)entries[i].enqueue, st_last.name,
+            (int)(entries[i].start - entries[i].enqueue), (int)(entries[i].end - entries[i].start),
+            entries[i].ok ? "OK" : "ERROR");
+    }
+}
@@ -0,0 +1,469 @@
+/*
+ * Stackless tasks over connection selector.
+ *
+ * Every task is a function, which returns to scheduler when operation cannot complete yet
+ * and continues on the same line when it is called again. Tasks do not have stack of their own,
+ * task state needs only few bytes, therefore many protocol tasks can run in single thread.
+ *
+ * Scheduler runs all tasks, then blocks on selector until any connection event
+ * and runs tasks again. Local variables of task function are not preserved
+ * while task waits, all state must be kept in task argument or in structure
+ * with task handle as first member.
+ */
+#include "conn_async.h"
+
+/**
+ * \brief           Check if task connection is still open on device
+ * \param[in]       t: Task handle
+ * \return          `1` if connection is active, `0` if it has been closed or replaced by new connection
+ */
+static uint8_t
+conn_async_conn_active(conn_async_task_t* t) {
+    esp_conn_p conn;
+
+    return (conn = conn_select_get_conn(&t->s->sel, t->h)) != NULL && esp_conn_is_active(conn);
+}
+
+/**
+ * \brief           Remove connection handle from accepted array
+ * \param[in]       s: Scheduler handle
+ * \param[in]       index: Index in accepted array
+ */
+static void
+conn_async_accepted_remove(conn_async_t* s, size_t index) {
+    s->accepted_cnt--;
+    memmove(&s->accepted[index], &s->accepted[index + 1], (s->accepted_cnt - index) * sizeof(s->accepted[0]));
+}
+
+/**
+ * \brief           Pass connection event to task or to accepted array
+ * \param[in]       s: Scheduler handle
+ * \param[in]       h: Handle of connection with event
+ * \param[in]       flags: Readiness flags of connection
+ */
+static void
+conn_async_dispatch(conn_async_t* s, conn_select_handle_t h, uint8_t flags) {
+    conn_async_task_t* t;
+    size_t i;
+
+    for (t = s->tasks; t != NULL; t = t->next) {
+        if (t->h == h) {
+            t->flags |= flags;
+            return;
+        }
+    }
+
+    /* Connection not owned by any task yet */
+    for (i = 0; i < s->accepted_cnt && s->accepted[i] != h; i++) {}
+    if (flags & CONN_SELECT_CLOSED) {
+        if (i < s->accepted_cnt) {
+            conn_async_accepted_remove(s, i);
+        }
+        conn_select_close(&s->sel, h);
+    } else if ((flags & CONN_SELECT_ACCEPT) && i == s->accepted_cnt) {
+        if (s->accepted_cnt < ESP_ARRAYSIZE(s->accepted)) {
+            s->accepted[s->accepted_cnt++] = h;
+            /* Take other clients of the same burst at once */
+            s->accepted_cnt += conn_select_accept_many(&s->sel, &s->accepted[s->accepted_cnt],
+                                                        ESP_ARRAYSIZE(s->accepted) - s->accepted_cnt);
+        } else {
+            conn_select_close(&s->sel, h);
+        }
+    }
+}
+
+/**
+ * \brief           Initialize scheduler
+ * \param[in]       s: Scheduler handle
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+conn_async_init(conn_async_t* s) {
+    s->tasks = NULL;
+    s->accepted_cnt = 0;
+    return conn_select_init(&s->sel);
+}
+
+/**
+ * \brief           Enable server, accepted connections are taken by tasks with \ref CONN_ASYNC_ACCEPT
+ * \param[in]       s: Scheduler handle
+ * \param[in]       port: Port to listen on
+ * \param[in]       max_conn: Maximal number of concurrent connections on server
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+conn_async_listen(conn_async_t* s, esp_port_t port, uint16_t max_conn) {
+    return conn_select_listen(&s->sel, port, max_conn);
+}
+
+/**
+ * \brief           Add task to scheduler
+ * \note            Function must be called before \ref conn_async_run or from another task
+ * \param[in]       s: Scheduler handle
+ * \param[in]       t: Task handle, must stay valid until task exits
+ * \param[in]       fn: Task function
+ * \param[in]       arg: User argument
+ */
+void
+conn_async_add(conn_async_t* s, conn_async_task_t* t, conn_async_fn fn, void* arg) {
+    memset(t, 0x00, sizeof(*t));
+    t->fn = fn;
+    t->arg = arg;
+    t->s = s;
+    t->next = s->tasks;
+    s->tasks = t;
+}
+
+/**
+ * \brief           Run tasks in current thread until all of them exit
+ * \param[in]       s: Scheduler handle
+ */
+void
+conn_async_run(conn_async_t* s) {
+    conn_async_task_t *t, **prev;
+    conn_select_handle_t h;
+    uint8_t flags;
+
+    while (1) {
+        /* Run every task until it waits or exits */
+        for (prev = &s->tasks; (t = *prev) != NULL;) {
+            if (t->fn(t) == CONN_ASYNC_EXITED) {
+                if (t->h != CONN_SELECT_HANDLE_INVALID) {   /* Task did not close its connection */
+                    conn_async_close(t);
+                }
+                *prev = t->next;
+            } else {
+                prev = &t->next;
+            }
+        }
+        if (s->tasks == NULL) {
+            break;
+        }
+
+        /* Sleep until there is any connection event */
+        if (conn_select_wait(&s->sel, &h, &flags, 0) == espOK && h != CONN_SELECT_HANDLE_INVALID) {
+            conn_async_dispatch(s, h, flags);
+        }
+    }
+}
+
+/**
+ * \brief           Close task connection
+ *
+ *                  Function does not wait for device to close connection,
+ *                  task may accept or connect again immediately
+ *
+ * \param[in]       t: Task handle
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+conn_async_close(conn_async_task_t* t) {
+    espr_t res = espOK;
+
+    if (t->h != CONN_SELECT_HANDLE_INVALID) {   /* Stale handle does not close new connection on the same number */
+        res = conn_select_close(&t->s->sel, t->h);
+    }
+    t->h = CONN_SELECT_HANDLE_INVALID;
+    t->flags = 0;
+    return res;
+}
+
+/**
+ * \brief           Take accepted connection, used by \ref CONN_ASYNC_ACCEPT
+ * \param[in]       t: Task handle
+ * \return          `1` when task has new connection, `0` otherwise
+ */
+uint8_t
+conn_async_try_accept(conn_async_task_t* t) {
+    conn_async_t* s = t->s;
+
+    if (s->accepted_cnt == 0) {
+        return 0;
+    }
+    t->h = s->accepted[0];
+    t->flags = 0;
+    t->res = espOK;
+    conn_async_accepted_remove(s, 0);
+    return 1;
+}
+
+/**
+ * \brief           Start client connection, used by \ref CONN_ASYNC_CONNECT
+ * \param[in]       t: Task handle
+ * \param[in]       type: Connection type
+ * \param[in]       host: Host name or IP address
+ * \param[in]       port: Port to connect to
+ * \return          \ref espOK if connection attempt has been started, member of \ref espr_t otherwise
+ */
+espr_t
+conn_async_connect_start(conn_async_task_t* t, esp_conn_type_t type, const char* host, esp_port_t port) {
+    t->h = CONN_SELECT_HANDLE_INVALID;
+    t->flags = 0;
+    return conn_select_connect(&t->s->sel, &t->req, type, host, port);
+}
+
+/**
+ * \brief           Check if client connection attempt finished, used by \ref CONN_ASYNC_CONNECT
+ * \param[in]       t: Task handle
+ * \return          `1` when connection is active or attempt failed, `0` otherwise
+ */
+uint8_t
+conn_async_connect_done(conn_async_task_t* t) {
+    espr_t res;
+
+    esp_sys_protect();
+    res = t->req.res;
+    esp_sys_unprotect();
+    if (res == espINPROG) {
+        return 0;
+    }
+    t->res = res;
+    t->h = t->req.h;
+    return 1;
+}
+
+/**
+ * \brief           Get received data, used by \ref CONN_ASYNC_RECEIVE
+ * \param[in]       t: Task handle
+ * \param[out]      p: Variable to save received chain to
+ * \return          `1` when data are received or connection is closed, `0` otherwise
+ */
+uint8_t
+conn_async_try_receive(conn_async_task_t* t, esp_pbuf_p* p) {
+    /* Received data are returned even after connection has been closed */
+    if ((*p = conn_select_receive(&t->s->sel, t->h)) != NULL) {
+        t->res = espOK;
+        return 1;
+    }
+    if ((t->flags & CONN_SELECT_CLOSED) || !conn_async_conn_active(t)) {
+        t->res = espCLOSED;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief           Start sending data, used by \ref CONN_ASYNC_WRITE
+ * \param[in]       t: Task handle
+ * \param[in]       data: Data to send
+ * \param[in]       len: Number of bytes to send
+ * \return          \ref espOK if data have been queued, member of \ref espr_t otherwise
+ */
+espr_t
+conn_async_write_start(conn_async_task_t* t, const void* data, size_t len) {
+    t->flags &= ~(CONN_SELECT_SENT | CONN_SELECT_ERROR);
+    return conn_select_send(&t->s->sel, t->h, data, len);
+}
+
+/**
+ * \brief           Check if data have been sent, used by \ref CONN_ASYNC_WRITE
+ * \param[in]       t: Task handle
+ * \return          `1` when send operation finished, `0` otherwise
+ */
+uint8_t
+conn_async_write_done(conn_async_task_t* t) {
+    if (t->flags & CONN_SELECT_SENT) {
+        t->res = espOK;
+    } else if (t->flags & CONN_SELECT_ERROR) {
+        t->res = espERR;
+    } else if ((t->flags & CONN_SELECT_CLOSED) || !conn_async_conn_active(t)) {
+        t->res = espCLOSED;
+    } else {
+        return 0;
+    }
+    t->flags &= ~(CONN_SELECT_SENT | CONN_SELECT_ERROR);
+    return 1;
+}
+
+/**
+ * \brief           HTTP response of example server
+ */
+static const char
+conn_async_http_resp[] = ""
+"HTTP/1.1 200 OK\r\n"
+"Content-Type: text/html\r\n"
+"Connection: close\r\n"
+"\r\n"
+"<html><body><p>Served by stackless task!</p></body></html>";
+
+/**
+ * \brief           HTTP request of example client
+ */
+static const char
+conn_async_http_req[] = ""
+"GET / HTTP/1.1\r\n"
+"Host: example.com\r\n"
+"Connection: close\r\n"
+"\r\n";
+
+/**
+ * \brief           MQTT CONNECT packet of example MQTT client, client ID `esp-async`, keep-alive 60 seconds
+ */
+static const uint8_t
+conn_async_mqtt_connect[] = {
+    0x10, 0x15, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x3C,
+    0x00, 0x09, 'e', 's', 'p', '-', 'a', 's', 'y', 'n', 'c'
+};
+
+/**
+ * \brief           MQTT PUBLISH packet with QoS 0 of example MQTT client, topic `esp/async`
+ */
+static const uint8_t
+conn_async_mqtt_publish[] = {
+    0x30, 0x10, 0x00, 0x09, 'e', 's', 'p', '/', 'a', 's', 'y', 'n', 'c',
+    'h', 'e', 'l', 'l', 'o'
+};
+
+/**
+ * \brief           MQTT DISCONNECT packet of example MQTT client
+ */
+static const uint8_t
+conn_async_mqtt_disconnect[] = { 0xE0, 0x00 };
+
+/**
+ * \brief           Example client task state
+ */
+typedef struct {
+    conn_async_task_t t;                        /*!< Task handle, must be first member */
+    size_t received;                            /*!< Number of received bytes */
+} conn_async_client_t;
+
+/**
+ * \brief           Example MQTT client task state
+ */
+typedef struct {
+    conn_async_task_t t;                        /*!< Task handle, must be first member */
+    uint8_t connack[4];                         /*!< Received CONNACK packet */
+    size_t connack_len;                         /*!< Number of received CONNACK bytes */
+} conn_async_mqtt_t;
+
+/**
+ * \brief           Example HTTP server task, serving one client at a time
+ * \param[in]       t: Task handle
+ * \return          \ref CONN_ASYNC_WAITING or \ref CONN_ASYNC_EXITED
+ */
+static uint8_t
+conn_async_server_task(conn_async_task_t* t) {
+    esp_pbuf_p p;
+
+    CONN_ASYNC_BEGIN(t);
+    while (1) {
+        CONN_ASYNC_ACCEPT(t);
+
+        /* Reply to first received packet, request itself is not parsed */
+        CONN_ASYNC_RECEIVE(t, p);
+        if (p != NULL) {
+            esp_pbuf_free(p);
+            CONN_ASYNC_WRITE(t, conn_async_http_resp, sizeof(conn_async_http_resp) - 1);
+        }
+        conn_async_close(t);
+    }
+    CONN_ASYNC_END(t);
+}
+
+/**
+ * \brief           Example HTTP client task, downloads page once
+ * \param[in]       t: Task handle
+ * \return          \ref CONN_ASYNC_WAITING or \ref CONN_ASYNC_EXITED
+ */
+static uint8_t
+conn_async_client_task(conn_async_task_t* t) {
+    conn_async_client_t* c = (conn_async_client_t *)t;
+    esp_pbuf_p p;
+
+    CONN_ASYNC_BEGIN(t);
+    CONN_ASYNC_CONNECT(t, ESP_CONN_TYPE_TCP, "example.com", 80);
+    if (t->res != espOK) {
+        printf("Async client cannot connect: %d\r\n", (int)t->res);
+        CONN_ASYNC_EXIT(t);
+    }
+    CONN_ASYNC_WRITE(t, conn_async_http_req, sizeof(conn_async_http_req) - 1);
+
+    /* Receive until server closes connection */
+    c->received = 0;
+    while (1) {
+        CONN_ASYNC_RECEIVE(t, p);
+        if (p == NULL) {
+            break;
+        }
+        c->received += esp_pbuf_length(p, 1);
+        esp_pbuf_free(p);
+    }
+    printf("Async client received %d bytes\r\n", (int)c->received);
+    conn_async_close(t);
+    CONN_ASYNC_END(t);
+}
+
+/**
+ * \brief           Example MQTT client task, connects to broker and publishes one message
+ * \param[in]       t: Task handle
+ * \return          \ref CONN_ASYNC_WAITING or \ref CONN_ASYNC_EXITED
+ */
+static uint8_t
+conn_async_mqtt_task(conn_async_task_t* t) {
+    conn_async_mqtt_t* m = (conn_async_mqtt_t *)t;
+    esp_pbuf_p p;
+
+    CONN_ASYNC_BEGIN(t);
+    CONN_ASYNC_CONNECT(t, ESP_CONN_TYPE_TCP, "test.mosquitto.org", 1883);
+    if (t->res != espOK) {
+        printf("Async MQTT client cannot connect: %d\r\n", (int)t->res);
+        CONN_ASYNC_EXIT(t);
+    }
+    CONN_ASYNC_WRITE(t, conn_async_mqtt_connect, sizeof(conn_async_mqtt_connect));
+
+    /* CONNACK may be split to more packets */
+    m->connack_len = 0;
+    while (t->res == espOK && m->connack_len < sizeof(m->connack)) {
+        CONN_ASYNC_RECEIVE(t, p);
+        if (p != NULL) {
+            m->connack_len += esp_pbuf_copy(p, &m->connack[m->connack_len], sizeof(m->connack) - m->connack_len, 0);
+            esp_pbuf_free(p);
+        }
+    }
+    if (m->connack_len < sizeof(m->connack) || m->connack[0] != 0x20 || m->connack[3] != 0x00) {
+        printf("Async MQTT client not accepted by broker\r\n");
+        conn_async_close(t);
+        CONN_ASYNC_EXIT(t);
+    }
+    CONN_ASYNC_WRITE(t, conn_async_mqtt_publish, sizeof(conn_async_mqtt_publish));
+    CONN_ASYNC_WRITE(t, conn_async_mqtt_disconnect, sizeof(conn_async_mqtt_disconnect));
+    printf("Async MQTT client published message: %d\r\n", (int)t->res);
+    conn_async_close(t);
+    CONN_ASYNC_END(t);
+}
+
+/**
+ * \brief           HTTP server on port 80 with 2 tasks, HTTP client and MQTT client, all in single thread
+ *
+ *                  Device supports single server port, therefore telnet server
+ *                  cannot run next to HTTP server and is not part of this example
+ *
+ * \param[in]       arg: User argument
+ */
+void
+conn_async_thread(void const* arg) {
+    static conn_async_t s;
+    static conn_async_task_t server_tasks[2];
+    static conn_async_client_t client;
+    static conn_async_mqtt_t mqtt;
+
+    if (conn_async_init(&s) != espOK) {
+        printf("Cannot create async scheduler!\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    if (conn_async_listen(&s, 80, ESP_CFG_MAX_CONNS) != espOK) {
+        printf("Cannot enable server on port 80!\r\n");
+    }
+    for (size_t i = 0; i < ESP_ARRAYSIZE(server_tasks); i++) {
+        conn_async_add(&s, &server_tasks[i], conn_async_server_task, NULL);
+    }
+    conn_async_add(&s, &client.t, conn_async_client_task, NULL);
+    conn_async_add(&s, &mqtt.t, conn_async_mqtt_task, NULL);
+
+    conn_async_run(&s);                         /* Returns when all tasks exit */
+
+    conn_select_deinit(&s.sel);
+    esp_sys_thread_terminate(NULL);
+}
@@ -0,0 +1,899 @@
+/*
+ * Connection selector allows single thread to serve
+ * all connections of ESP device, without thread per client.
+ *
+ * Connection callbacks put received data to per-link pbuf chain
+ * and put link to single ready message box. User thread blocks on that message box
+ * until any connection is accepted or connected, has data to read, has sent data or is closed.
+ *
+ * ESP device supports single server at a time,
+ * therefore only one selector may listen for incoming connections.
+ *
+ * With manual TCP receive, device sends next data only after previous are confirmed
+ * with esp_conn_recved. Selector confirms data immediately while receive queue
+ * of connection is below limit, set from rate user reads data at, and there is enough free memory.
+ * Otherwise confirmation is delayed until user reads data with conn_select_receive.
+ *
+ * Connections are identified by conn_select_handle_t, not by connection pointer.
+ * Pointer is the same for every connection on the same number, handle becomes invalid
+ * once connection is closed, therefore stale handle never operates on new connection.
+ */
+#include "conn_select.h"
+#include "pbuf_cursor.h"
+#include "esp/esp_mem.h"
+
+static espr_t conn_select_evt(esp_evt_t* evt);
+
+/**
+ * \brief           Selector used for server connections
+ */
+static conn_select_t*
+conn_select_server;
+
+/**
+ * \brief           Get link for connection
+ * \param[in]       sel: Selector handle
+ * \param[in]       conn: Connection handle
+ * \return          Link handle or `NULL` on failure
+ */
+static conn_select_link_t*
+conn_select_get_link(conn_select_t* sel, esp_conn_p conn) {
+    int8_t num;
+
+    num = esp_conn_getnum(conn);
+    if (num < 0 || num >= ESP_CFG_MAX_CONNS) {
+        return NULL;
+    }
+    return &sel->links[num];
+}
+
+/**
+ * \brief           Get link for connection handle
+ * \note            Function must be called with system protection
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \return          Link handle or `NULL` if handle is not valid anymore or connection is being closed by user
+ */
+static conn_select_link_t*
+conn_select_get_link_h(conn_select_t* sel, conn_select_handle_t h) {
+    conn_select_link_t* link;
+
+    if (h == CONN_SELECT_HANDLE_INVALID || CONN_SELECT_HANDLE_NUM(h) >= ESP_ARRAYSIZE(sel->links)) {
+        return NULL;
+    }
+    link = &sel->links[CONN_SELECT_HANDLE_NUM(h)];
+    if (link->conn == NULL || link->closing || link->gen != (uint16_t)(h >> 8)) {
+        return NULL;
+    }
+    return link;
+}
+
+/**
+ * \brief           Get handle of connection currently on link
+ * \note            Function must be called with system protection
+ * \param[in]       sel: Selector handle
+ * \param[in]       link: Link with connection
+ * \return          Connection handle
+ */
+static conn_select_handle_t
+conn_select_link_handle(conn_select_t* sel, conn_select_link_t* link) {
+    return ((uint32_t)link->gen << 8) | (uint32_t)(link - sel->links);
+}
+
+/**
+ * \brief           Release link of connection and drop all its pending data
+ * \note            Function must be called with system protection
+ * \param[in]       sel: Selector handle
+ * \param[in]       link: Link with connection
+ * \return          Connection which was on link
+ */
+static esp_conn_p
+conn_select_link_release(conn_select_t* sel, conn_select_link_t* link) {
+    esp_conn_p conn = link->conn;
+
+    link->conn = NULL;
+    link->closing = 0;
+    link->flags = 0;
+    pbuf_chain_free(&link->rx);
+    if (link->accept_pending) {
+        link->accept_pending = 0;
+        sel->accept_pending_cnt--;
+    }
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
+    if (link->unacked != NULL) {                /* Connection is closing, no need to confirm */
+        esp_pbuf_free(link->unacked);
+        link->unacked = NULL;
+    }
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE */
+    return conn;
+}
+
+/**
+ * \brief           Set readiness flags on link and notify waiting thread
+ * \note            Function must be called with system protection
+ * \param[in]       sel: Selector handle
+ * \param[in]       link: Link to notify
+ * \param[in]       flags: Flags to set
+ */
+static void
+conn_select_signal(conn_select_t* sel, conn_select_link_t* link, uint8_t flags) {
+    link->flags |= flags;
+    if (!link->queued) {
+        link->queued = 1;
+        esp_sys_mbox_putnow(&sel->ready, link); /* Never full, there is one entry per link */
+    }
+}
+
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE || __DOXYGEN__
+
+/**
+ * \brief           Check if device may send more data on connection
+ *
+ *                  Called after received pbuf is appended, queue is never empty.
+ *                  Held confirmation is sent when user reads all data, see \ref conn_select_receive
+ *
+ * \note            Function must be called with system protection
+ * \param[in]       link: Connection link
+ * \return          `1` if received data may be confirmed, `0` otherwise
+ */
+static uint8_t
+conn_select_rx_window_open(conn_select_link_t* link) {
+    size_t queued, limit;
+
+    queued = pbuf_chain_length(&link->rx);
+    if (esp_mem_getfree() < CONN_SELECT_RX_MEM_RESERVE) {
+        return 0;
+    }
+    limit = (size_t)((uint64_t)link->drain_rate * CONN_SELECT_RX_LATENCY / 1000);
+    return queued <= ESP_MAX(limit, ESP_CFG_IPD_MAX_BUFF_SIZE);
+}
+
+/**
+ * \brief           Update drain rate after user read data
+ * \note            Function must be called with system protection
+ * \param[in]       link: Connection link
+ * \param[in]       len: Number of bytes read by user
+ */
+static void
+conn_select_rx_drained(conn_select_link_t* link, size_t len) {
+    uint32_t dt;
+
+    dt = esp_sys_now() - link->rx_time;         /* Time data were waiting for user */
+    if (dt == 0) {
+        dt = 1;
+    }
+    link->drain_rate = (size_t)((3 * (uint64_t)link->drain_rate + (uint64_t)len * 1000 / dt) / 4);
+}
+
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE || __DOXYGEN__ */
+
+/**
+ * \brief           Mark server connection as taken by user and update accept statistics
+ * \note            Function must be called with system protection
+ * \param[in]       sel: Selector handle
+ * \param[in]       link: Link with pending accepted connection
+ */
+static void
+conn_select_accept_taken(conn_select_t* sel, conn_select_link_t* link) {
+    uint32_t wait;
+
+    wait = esp_sys_now() - link->accept_time;
+    sel->accept_stats.accepted++;
+    sel->accept_stats.wait_total += wait;
+    if (wait > sel->accept_stats.wait_max) {
+        sel->accept_stats.wait_max = wait;
+    }
+    link->accept_pending = 0;
+    sel->accept_pending_cnt--;
+}
+
+/**
+ * \brief           Connection callback function for all selector connections
+ * \param[in]       evt: Event information with data
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+conn_select_evt(esp_evt_t* evt) {
+    conn_select_t* sel;
+    conn_select_link_t* link;
+    conn_select_connect_t* req = NULL;
+    esp_conn_p conn;
+    esp_pbuf_p pbuf;
+
+    if (esp_evt_get_type(evt) == ESP_EVT_CONN_ERROR) {
+        /* Client connection failed, there is no connection handle */
+        if ((req = esp_evt_conn_error_get_arg(evt)) != NULL) {
+            esp_sys_protect();
+            req->res = esp_evt_conn_error_get_error(evt);
+            conn_select_signal(req->sel, &req->sel->notify, CONN_SELECT_ERROR);
+            esp_sys_unprotect();
+        }
+        return espOK;
+    }
+
+    conn = esp_conn_get_from_evt(evt);
+    if (conn == NULL) {
+        return espOK;
+    }
+    sel = esp_conn_get_arg(conn);
+    if (esp_evt_get_type(evt) == ESP_EVT_CONN_ACTIVE && esp_conn_is_client(conn)) {
+        req = (void *)sel;                      /* Client connection has request as argument until active */
+        sel = req->sel;
+        esp_conn_set_arg(conn, sel);
+    } else if (sel == NULL) {                   /* New server connection has no argument yet */
+        sel = conn_select_server;
+        if (sel == NULL) {
+            esp_conn_close(conn, 0);
+            return espOK;
+        }
+        esp_conn_set_arg(conn, sel);
+    }
+    if ((link = conn_select_get_link(sel, conn)) == NULL) {
+        return espERR;
+    }
+
+    esp_sys_protect();
+    switch (esp_evt_get_type(evt)) {
+        case ESP_EVT_CONN_ACTIVE: {
+            if (req == NULL && sel->accept_pending_cnt >= sel->backlog) {
+                sel->accept_stats.dropped++;    /* User does not keep up, refuse new client */
+                esp_conn_set_arg(conn, NULL);
+                esp_conn_close(conn, 0);
+                break;
+            }
+            if (link->accept_pending) {         /* Previous connection on link was never taken */
+                link->accept_pending = 0;
+                sel->accept_pending_cnt--;
+            }
+            pbuf_chain_free(&link->rx);         /* Link may be reused */
+            link->conn = conn;
+            link->closing = 0;
+            link->flags = 0;
+            if (++link->gen == 0) {             /* Generation 0 is used by invalid handle only */
+                link->gen = 1;
+            }
+            conn_stats_reset(&link->stats);
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
+            if (link->unacked != NULL) {
+                esp_pbuf_free(link->unacked);
+                link->unacked = NULL;
+            }
+            link->drain_rate = 0;
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE */
+            if (req != NULL) {
+                req->h = conn_select_link_handle(sel, link);
+                req->res = espOK;
+            } else {
+                link->accept_pending = 1;
+                link->accept_time = esp_sys_now();
+                sel->accept_pending_cnt++;
+            }
+            conn_select_signal(sel, link, req != NULL ? CONN_SELECT_CONNECTED : CONN_SELECT_ACCEPT);
+            break;
+        }
+        case ESP_EVT_CONN_SEND: {
+            if (link->conn == conn) {           /* Report also on closing link, user may free sent data now */
+                conn_stats_send_done(&link->stats, esp_evt_conn_send_get_result(evt), esp_evt_conn_send_get_length(evt));
+                conn_select_signal(sel, link, esp_evt_conn_send_get_result(evt) == espOK ? CONN_SELECT_SENT : CONN_SELECT_ERROR);
+                if (link->closing && link->stats.sends_pending == 0 && !esp_conn_is_active(conn)) {
+                    conn_select_link_release(sel, link);    /* Last send of closed connection has finished */
+                }
+            }
+            break;
+        }
+        case ESP_EVT_CONN_RECV: {
+            pbuf = esp_evt_conn_recv_get_buff(evt);
+            if (link->conn == conn && !link->closing) {
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
+                if (pbuf_chain_length(&link->rx) == 0) {
+                    link->rx_time = esp_sys_now();
+                }
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE */
+                conn_stats_recv(&link->stats, esp_pbuf_length(pbuf, 1));
+                esp_pbuf_ref(pbuf);             /* Keep pbuf after callback returns */
+                pbuf_chain_append(&link->rx, pbuf);
+                conn_select_signal(sel, link, CONN_SELECT_READABLE);
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
+                if (link->unacked == NULL && !conn_select_rx_window_open(link)) {
+                    esp_pbuf_ref(pbuf);         /* Confirm once user reads data */
+                    link->unacked = pbuf;
+                    break;
+                }
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE */
+            }
+            esp_conn_recved(conn, pbuf);        /* Notify stack data were processed */
+            break;
+        }
+        case ESP_EVT_CONN_CLOSED: {
+            if (link->conn == conn) {
+                if (link->closing && link->stats.sends_pending == 0) {
+                    conn_select_link_release(sel, link);    /* Close started by user has finished, link is free */
+                }
+                conn_select_signal(sel, link, CONN_SELECT_CLOSED);
+            }
+            esp_conn_set_arg(conn, NULL);       /* Connection number may be reused for server */
+            break;
+        }
+        default: break;
+    }
+    esp_sys_unprotect();
+    return espOK;
+}
+
+/**
+ * \brief           Initialize selector
+ * \param[in]       sel: Selector handle
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+conn_select_init(conn_select_t* sel) {
+    memset(sel, 0x00, sizeof(*sel));
+    sel->backlog = ESP_CFG_MAX_CONNS;
+    if (!esp_sys_mbox_create(&sel->ready, ESP_CFG_MAX_CONNS + 1)) {
+        esp_sys_mbox_invalid(&sel->ready);
+        return espERRMEM;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Stop server and release all selector resources
+ * \param[in]       sel: Selector handle
+ */
+void
+conn_select_deinit(conn_select_t* sel) {
+    esp_conn_p conn;
+
+    if (conn_select_server == sel) {
+        esp_set_server(0, 0, 0, 0, NULL, NULL, NULL, 1);
+        conn_select_server = NULL;
+    }
+    for (size_t i = 0; i < ESP_ARRAYSIZE(sel->links); i++) {
+        esp_sys_protect();
+        conn = sel->links[i].conn != NULL ? conn_select_link_release(sel, &sel->links[i]) : NULL;
+        esp_sys_unprotect();
+        if (conn != NULL && esp_conn_is_active(conn)) {
+            esp_conn_close(conn, 1);            /* Selector memory may be released after return */
+        }
+    }
+    if (esp_sys_mbox_isvalid(&sel->ready)) {
+        esp_sys_mbox_delete(&sel->ready);
+        esp_sys_mbox_invalid(&sel->ready);
+    }
+}
+
+/**
+ * \brief           Enable server and accept new connections to selector
+ * \param[in]       sel: Selector handle
+ * \param[in]       port: Port to listen on
+ * \param[in]       max_conn: Maximal number of concurrent connections on server
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+conn_select_listen(conn_select_t* sel, esp_port_t port, uint16_t max_conn) {
+    espr_t res;
+
+    conn_select_server = sel;
+    res = esp_set_server(1, port, max_conn, 100, conn_select_evt, NULL, NULL, 1);
+    if (res != espOK) {
+        conn_select_server = NULL;
+    }
+    return res;
+}
+
+/**
+ * \brief           Set maximal number of server connections waiting to be taken by user
+ *
+ *                  Connection is waiting from the moment it is active until it is reported
+ *                  with \ref CONN_SELECT_ACCEPT flag or taken with \ref conn_select_accept_many.
+ *                  New connections are closed immediately when backlog is full
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       backlog: Maximal number of waiting connections, default is \ref ESP_CFG_MAX_CONNS
+ */
+void
+conn_select_set_backlog(conn_select_t* sel, size_t backlog) {
+    esp_sys_protect();
+    sel->backlog = ESP_MAX(backlog, 1);
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Take all server connections waiting to be accepted, oldest first
+ * \param[in]       sel: Selector handle
+ * \param[out]      hs: Array to save connection handles to
+ * \param[in]       max: Number of entries in array
+ * \return          Number of connections saved to array
+ */
+size_t
+conn_select_accept_many(conn_select_t* sel, conn_select_handle_t* hs, size_t max) {
+    conn_select_link_t* oldest;
+    size_t n = 0;
+
+    esp_sys_protect();
+    while (n < max && sel->accept_pending_cnt > 0) {
+        oldest = NULL;
+        for (size_t i = 0; i < ESP_ARRAYSIZE(sel->links); i++) {
+            if (sel->links[i].accept_pending
+                && (oldest == NULL || (int32_t)(sel->links[i].accept_time - oldest->accept_time) < 0)) {
+                oldest = &sel->links[i];
+            }
+        }
+        conn_select_accept_taken(sel, oldest);
+        oldest->flags &= ~CONN_SELECT_ACCEPT;   /* Do not report it again */
+        hs[n++] = conn_select_link_handle(sel, oldest);
+    }
+    esp_sys_unprotect();
+    return n;
+}
+
+/**
+ * \brief           Get copy of accept statistics
+ * \param[in]       sel: Selector handle
+ * \param[out]      stats: Output variable to copy statistics to
+ */
+void
+conn_select_get_accept_stats(conn_select_t* sel, conn_select_accept_stats_t* stats) {
+    esp_sys_protect();
+    *stats = sel->accept_stats;
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Start new client connection in non-blocking mode
+ *
+ *                  Connection is added to selector once active and reported with \ref CONN_SELECT_CONNECTED flag.
+ *                  Failed attempt is reported with \ref CONN_SELECT_ERROR flag and \ref CONN_SELECT_HANDLE_INVALID handle
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       req: Request handle, must stay valid until request completes.
+ *                      Result is available in `res` member once it is not \ref espINPROG anymore
+ * \param[in]       type: Connection type
+ * \param[in]       host: Host name or IP address. String must stay valid until request completes
+ * \param[in]       port: Port to connect to
+ * \return          \ref espOK if connection attempt has been started, member of \ref espr_t otherwise
+ */
+espr_t
+conn_select_connect(conn_select_t* sel, conn_select_connect_t* req, esp_conn_type_t type, const char* host, esp_port_t port) {
+    espr_t res;
+
+    req->sel = sel;
+    req->h = CONN_SELECT_HANDLE_INVALID;
+    req->res = espINPROG;
+    if ((res = esp_conn_start(NULL, type, host, port, req, conn_select_evt, 0)) != espOK) {
+        req->res = res;
+    }
+    return res;
+}
+
+/**
+ * \brief           Wait for any connection to become ready
+ * \param[in]       sel: Selector handle
+ * \param[out]      h: Handle of connection which is ready or \ref CONN_SELECT_HANDLE_INVALID for failed connection attempt
+ * \param[out]      flags: Readiness flags of connection, combination of `CONN_SELECT_*` values
+ * \param[in]       timeout: Maximal time to wait in units of milliseconds. Use `0` to wait forever
+ * \return          \ref espOK on success, \ref espTIMEOUT if no connection is ready
+ */
+espr_t
+conn_select_wait(conn_select_t* sel, conn_select_handle_t* h, uint8_t* flags, uint32_t timeout) {
+    conn_select_link_t* link;
+    void* msg;
+
+    if (esp_sys_mbox_get(&sel->ready, &msg, timeout) == ESP_SYS_TIMEOUT) {
+        return espTIMEOUT;
+    }
+    link = msg;
+
+    esp_sys_protect();
+    *h = link != &sel->notify ? conn_select_link_handle(sel, link) : CONN_SELECT_HANDLE_INVALID;
+    *flags = link->flags;
+    if ((*flags & CONN_SELECT_ACCEPT) && link->accept_pending) {
+        conn_select_accept_taken(sel, link);
+    }
+    link->flags = 0;
+    link->queued = 0;
+    esp_sys_unprotect();
+    return *h != CONN_SELECT_HANDLE_INVALID || *flags ? espOK : espCLOSED;
+}
+
+/**
+ * \brief           Get all data received on connection
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \return          Chain of received pbufs or `NULL` if there are no data or handle is not valid anymore.
+ *                  User must free chain with \ref esp_pbuf_free
+ */
+esp_pbuf_p
+conn_select_receive(conn_select_t* sel, conn_select_handle_t h) {
+    conn_select_link_t* link;
+    esp_pbuf_p p = NULL;
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
+    esp_pbuf_p ack = NULL;
+    esp_conn_p conn = NULL;
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE */
+
+    esp_sys_protect();
+    if ((link = conn_select_get_link_h(sel, h)) != NULL) {
+        p = pbuf_chain_take(&link->rx);
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
+        if (p != NULL) {
+            conn_select_rx_drained(link, esp_pbuf_length(p, 1));
+        }
+        conn = link->conn;
+        ack = link->unacked;                    /* Queue is empty now, let device send more */
+        link->unacked = NULL;
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE */
+    }
+    esp_sys_unprotect();
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
+    if (ack != NULL) {
+        esp_conn_recved(conn, ack);
+        esp_pbuf_free(ack);
+    }
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE */
+    return p;
+}
+
+/**
+ * \brief           Queue send command and count it in connection statistics
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \param[in]       data: Data to send
+ * \param[in]       btw: Number of bytes to send
+ * \param[in]       retry: Set to `1` when the same data failed to send before
+ * \return          \ref espOK if data have been queued, member of \ref espr_t otherwise
+ */
+static espr_t
+conn_select_send_int(conn_select_t* sel, conn_select_handle_t h, const void* data, size_t btw, uint8_t retry) {
+    conn_select_link_t* link;
+    esp_conn_p conn;
+    espr_t res;
+
+    esp_sys_protect();
+    if ((link = conn_select_get_link_h(sel, h)) == NULL) {
+        esp_sys_unprotect();
+        return espCLOSED;
+    }
+    conn = link->conn;
+    conn_stats_send_start(&link->stats, btw, retry);
+    esp_sys_unprotect();
+    if ((res = esp_conn_send(conn, data, btw, NULL, 0)) != espOK) {
+        esp_sys_protect();
+        if ((link = conn_select_get_link_h(sel, h)) != NULL) {
+            conn_stats_send_cancel(&link->stats, btw, retry);   /* Command was not queued */
+        }
+        esp_sys_unprotect();
+    }
+    return res;
+}
+
+/**
+ * \brief           Send data on connection in non-blocking mode
+ *
+ *                  Result is reported with \ref CONN_SELECT_SENT or \ref CONN_SELECT_ERROR flag
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \param[in]       data: Data to send. Memory must stay valid until result is reported
+ * \param[in]       btw: Number of bytes to send
+ * \return          \ref espOK if data have been queued, \ref espCLOSED if handle is not valid anymore,
+ *                      member of \ref espr_t otherwise
+ */
+espr_t
+conn_select_send(conn_select_t* sel, conn_select_handle_t h, const void* data, size_t btw) {
+    return conn_select_send_int(sel, h, data, btw, 0);
+}
+
+/**
+ * \brief           Send data again after send operation reported \ref CONN_SELECT_ERROR flag
+ *
+ *                  Works as \ref conn_select_send, operation is counted as retry in connection statistics
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \param[in]       data: Data to send. Memory must stay valid until result is reported
+ * \param[in]       btw: Number of bytes to send
+ * \return          \ref espOK if data have been queued, \ref espCLOSED if handle is not valid anymore,
+ *                      member of \ref espr_t otherwise
+ */
+espr_t
+conn_select_send_retry(conn_select_t* sel, conn_select_handle_t h, const void* data, size_t btw) {
+    return conn_select_send_int(sel, h, data, btw, 1);
+}
+
+/**
+ * \brief           Close connection in non-blocking mode
+ *
+ *                  Call this function also when \ref CONN_SELECT_CLOSED flag is reported.
+ *                  Stale handle of connection, which number has been reused, does not close new connection.
+ *
+ *                  When connection is still active, handle becomes invalid immediately
+ *                  and function returns without waiting for device. Link is released once device closes connection,
+ *                  which is reported with \ref CONN_SELECT_CLOSED flag for the same handle.
+ *                  Result of every send in progress is still reported with \ref CONN_SELECT_SENT
+ *                  or \ref CONN_SELECT_ERROR flag for the same handle, link is kept until then
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \return          \ref espOK on success, \ref espCLOSED if handle is not valid anymore,
+ *                      member of \ref espr_t otherwise
+ */
+espr_t
+conn_select_close(conn_select_t* sel, conn_select_handle_t h) {
+    conn_select_link_t* link;
+    esp_conn_p conn;
+    espr_t res;
+
+    esp_sys_protect();
+    if ((link = conn_select_get_link_h(sel, h)) == NULL) {
+        esp_sys_unprotect();
+        return espCLOSED;
+    }
+    conn = link->conn;
+    conn_select_link_release(sel, link);
+    if (!esp_conn_is_active(conn)) {
+        if (link->stats.sends_pending > 0) {    /* Already closed by remote side, wait for send results */
+            link->conn = conn;
+            link->closing = 1;
+        }
+        esp_sys_unprotect();
+        return espOK;
+    }
+    link->conn = conn;                          /* Keep link until device reports connection closed */
+    link->closing = 1;
+    esp_sys_unprotect();
+
+    if ((res = esp_conn_close(conn, 0)) != espOK) {
+        esp_sys_protect();
+        if (link->conn == conn && link->closing) {
+            conn_select_link_release(sel, link);
+        }
+        esp_sys_unprotect();
+    }
+    return res;
+}
+
+/**
+ * \brief           Get statistics of next active connection
+ *
+ *                  Set index to `0` before first call, function updates it for next call
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in,out]   index: Iterator index
+ * \param[out]      h: Output variable to save connection handle to
+ * \param[out]      stats: Output variable to copy statistics to
+ * \return          `1` if connection was found, `0` when there are no more connections
+ */
+uint8_t
+conn_select_stats_next(conn_select_t* sel, size_t* index, conn_select_handle_t* h, conn_stats_t* stats) {
+    conn_select_link_t* link;
+
+    for (; *index < ESP_ARRAYSIZE(sel->links); (*index)++) {
+        link = &sel->links[*index];
+        esp_sys_protect();
+        *h = CONN_SELECT_HANDLE_INVALID;
+        if (link->conn != NULL && !link->closing) {
+            *h = conn_select_link_handle(sel, link);
+            *stats = link->stats;
+            stats->queued = pbuf_chain_length(&link->rx);
+        }
+        esp_sys_unprotect();
+        if (*h != CONN_SELECT_HANDLE_INVALID) {
+            (*index)++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief           Print statistics of all active connections
+ * \param[in]       sel: Selector handle
+ */
+void
+conn_select_stats_dump(conn_select_t* sel) {
+    conn_stats_t stats;
+    conn_select_handle_t h;
+    size_t i = 0;
+
+    while (conn_select_stats_next(sel, &i, &h, &stats)) {
+        conn_stats_print((int8_t)CONN_SELECT_HANDLE_NUM(h), &stats);
+    }
+}
+
+/**
+ * \brief           Get handle of connection
+ *
+ *                  Unlike connection pointer, which is the same for every connection on the same number,
+ *                  handle becomes invalid once connection is closed and number is used by new connection.
+ *                  Use it to get handle of connection reported by library outside of selector
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       conn: Connection handle
+ * \return          Connection handle or \ref CONN_SELECT_HANDLE_INVALID if connection is not on selector
+ */
+conn_select_handle_t
+conn_select_get_handle(conn_select_t* sel, esp_conn_p conn) {
+    conn_select_link_t* link;
+    conn_select_handle_t h = CONN_SELECT_HANDLE_INVALID;
+
+    if ((link = conn_select_get_link(sel, conn)) != NULL) {
+        esp_sys_protect();
+        if (link->conn == conn && !link->closing) {
+            h = conn_select_link_handle(sel, link);
+        }
+        esp_sys_unprotect();
+    }
+    return h;
+}
+
+/**
+ * \brief           Get connection from handle
+ *
+ *                  Use returned connection only for queries, such as remote address,
+ *                  pointer does not detect reuse of connection number
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \return          Connection or `NULL` if handle is not valid anymore
+ */
+esp_conn_p
+conn_select_get_conn(conn_select_t* sel, conn_select_handle_t h) {
+    conn_select_link_t* link;
+    esp_conn_p conn = NULL;
+
+    esp_sys_protect();
+    if ((link = conn_select_get_link_h(sel, h)) != NULL) {
+        conn = link->conn;
+    }
+    esp_sys_unprotect();
+    return conn;
+}
+
+/**
+ * \brief           Echo state of single connection
+ */
+typedef struct {
+    esp_pbuf_p p;                               /*!< Received data being sent back or `NULL` */
+    pbuf_cursor_t c;                            /*!< Cursor at first byte not sent yet */
+    size_t len;                                 /*!< Length of span in progress, `0` if nothing is being sent */
+    uint8_t retried;                            /*!< Set to `1` when span in progress has been sent again after error */
+    uint8_t closed;                             /*!< Set to `1` when connection is closed while span is in progress */
+} conn_select_echo_t;
+
+/**
+ * \brief           Drop data of echo connection
+ * \param[in]       e: Echo state
+ */
+static void
+conn_select_echo_reset(conn_select_echo_t* e) {
+    if (e->p != NULL) {
+        esp_pbuf_free(e->p);
+        e->p = NULL;
+    }
+    e->len = 0;
+    e->retried = 0;
+    e->closed = 0;
+}
+
+/**
+ * \brief           Send span which failed to send once more
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \param[in]       e: Echo state of connection
+ * \return          `1` if span has been queued again, `0` otherwise
+ */
+static uint8_t
+conn_select_echo_retry(conn_select_t* sel, conn_select_handle_t h, conn_select_echo_t* e) {
+    const void* d;
+    size_t len;
+
+    if (e->len == 0 || e->retried || (d = pbuf_cursor_span(&e->c, &len)) == NULL
+        || conn_select_send_retry(sel, h, d, e->len) != espOK) {
+        return 0;
+    }
+    e->retried = 1;
+    return 1;
+}
+
+/**
+ * \brief           Send next span of received data back with \ref conn_select_send
+ *
+ *                  Only one span per connection is in progress at a time,
+ *                  received data must stay valid until \ref CONN_SELECT_SENT flag is reported
+ *
+ * \param[in]       sel: Selector handle
+ * \param[in]       h: Connection handle
+ * \param[in]       e: Echo state of connection
+ */
+static void
+conn_select_echo_next(conn_select_t* sel, conn_select_handle_t h, conn_select_echo_t* e) {
+    const void* d;
+    size_t len;
+
+    while (e->len == 0) {
+        if (e->p == NULL) {
+            if ((e->p = conn_select_receive(sel, h)) == NULL) {
+                return;                         /* Nothing to send */
+            }
+            pbuf_cursor_init(&e->c, e->p, 0);
+        }
+        if ((d = pbuf_cursor_span(&e->c, &len)) == NULL) {
+            conn_select_echo_reset(e);          /* All data sent, check for new data */
+            continue;
+        }
+        if (conn_select_send(sel, h, d, len) != espOK) {
+            conn_select_echo_reset(e);
+            return;
+        }
+        e->len = len;
+    }
+}
+
+/**
+ * \brief           Echo server on port 23, serving all clients from this thread only
+ * \param[in]       arg: User argument
+ */
+void
+conn_select_server_thread(void const* arg) {
+    static conn_select_t sel;
+    static conn_select_echo_t echo[ESP_CFG_MAX_CONNS];
+    conn_select_echo_t* e;
+    conn_select_handle_t h;
+    uint8_t flags;
+
+    if (conn_select_init(&sel) != espOK) {
+        printf("Cannot create selector!\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    if (conn_select_listen(&sel, 23, ESP_CFG_MAX_CONNS) != espOK) {
+        printf("Cannot enable server on port 23!\r\n");
+        conn_select_deinit(&sel);
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    printf("Selector server listens on port 23\r\n");
+
+    while (1) {
+        if (conn_select_wait(&sel, &h, &flags, 0) != espOK) {
+            continue;
+        }
+        if (h == CONN_SELECT_HANDLE_INVALID) {
+            continue;
+        }
+        e = &echo[CONN_SELECT_HANDLE_NUM(h)];
+        if (flags & CONN_SELECT_ACCEPT) {
+            printf("Connection %d accepted\r\n", (int)CONN_SELECT_HANDLE_NUM(h));
+            conn_select_echo_reset(e);
+        }
+        if (e->closed && (flags & (CONN_SELECT_SENT | CONN_SELECT_ERROR))) {
+            conn_select_echo_reset(e);          /* Send of closed connection has finished, data may be freed */
+            continue;
+        }
+        if (flags & CONN_SELECT_SENT) {
+            pbuf_cursor_skip(&e->c, e->len);    /* Span has been sent */
+            e->len = 0;
+            e->retried = 0;
+        }
+        if (flags & CONN_SELECT_ERROR) {
+            if (!conn_select_echo_retry(&sel, h, e)) {
+                conn_select_echo_reset(e);      /* Failed twice, drop received data */
+            }
+        }
+        if ((flags & (CONN_SELECT_READABLE | CONN_SELECT_SENT)) && !(flags & CONN_SELECT_CLOSED)) {
+            /* Send received data back, span by span, without blocking this thread */
+            conn_select_echo_next(&sel, h, e);
+        }
+        if (flags & CONN_SELECT_CLOSED) {
+            printf("Connection %d closed\r\n", (int)CONN_SELECT_HANDLE_NUM(h));
+            conn_select_stats_dump(&sel);
+            conn_select_close(&sel, h);
+            if (e->len > 0) {
+                e->closed = 1;                  /* Send in progress still uses data, free them on its result */
+            } else {
+                conn_select_echo_reset(e);
+            }
+        }
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * Connection selector benchmark drives all connections of ESP device at the same time.
+ *
+ * Every connection is connected to TCP echo server and keeps single block of data in flight.
+ * All events are processed by single thread, which reports throughput
+ * of every connection and number of events processed per second.
+ *
+ * Connections are tracked with selector handles, events for connection number
+ * reused by another connection are counted as stale.
+ */
+#include "conn_select_bench.h"
+#include "conn_select.h"
+
+/**
+ * \brief           Benchmark state of single connection
+ */
+typedef struct {
+    conn_select_connect_t req;                  /*!< Connection request */
+    conn_select_handle_t h;                     /*!< Connection handle once active */
+    size_t tx;                                  /*!< Number of bytes sent */
+    size_t rx;                                  /*!< Number of bytes received */
+    uint8_t send_failed;                        /*!< Set to `1` when next block could not be queued, link stopped sending */
+} conn_select_bench_link_t;
+
+/**
+ * \brief           Data sent on every connection
+ */
+static uint8_t
+conn_select_bench_block[CONN_SELECT_BENCH_BLOCK_LEN];
+
+/**
+ * \brief           Benchmark thread
+ * \param[in]       arg: User argument
+ */
+void
+conn_select_bench_thread(void const* arg) {
+    static conn_select_t sel;
+    static conn_select_bench_link_t links[ESP_CFG_MAX_CONNS];
+    static conn_select_bench_link_t* by_num[ESP_CFG_MAX_CONNS];
+    conn_select_bench_link_t* l;
+    conn_select_handle_t h;
+    esp_pbuf_p p;
+    size_t pending, active = 0, tx = 0, rx = 0;
+    uint32_t start, time, events = 0, stale = 0, send_failed = 0;
+    uint8_t flags;
+
+    if (conn_select_init(&sel) != espOK) {
+        printf("Cannot create selector!\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    for (size_t i = 0; i < ESP_ARRAYSIZE(conn_select_bench_block); i++) {
+        conn_select_bench_block[i] = (uint8_t)i;
+    }
+
+    /* Start all connections at once and wait for results */
+    pending = 0;
+    for (size_t i = 0; i < ESP_ARRAYSIZE(links); i++) {
+        if (conn_select_connect(&sel, &links[i].req, ESP_CONN_TYPE_TCP, CONN_SELECT_BENCH_HOST, CONN_SELECT_BENCH_PORT) == espOK) {
+            pending++;
+        }
+    }
+    start = esp_sys_now();
+    while (pending > 0 && esp_sys_now() - start < CONN_SELECT_BENCH_DURATION) {
+        conn_select_wait(&sel, &h, &flags, 100);
+        pending = 0;
+        for (size_t i = 0; i < ESP_ARRAYSIZE(links); i++) {
+            pending += links[i].req.res == espINPROG;
+        }
+    }
+
+    /* Put first block in flight on every connection */
+    for (size_t i = 0; i < ESP_ARRAYSIZE(links); i++) {
+        l = &links[i];
+        l->h = CONN_SELECT_HANDLE_INVALID;
+        if (l->req.res != espOK || conn_select_get_conn(&sel, l->req.h) == NULL) {
+            continue;                           /* Not connected or already closed, do not take slot of other connection */
+        }
+        l->h = l->req.h;
+        by_num[CONN_SELECT_HANDLE_NUM(l->h)] = l;   /* Direct lookup by connection number */
+        if (conn_select_send(&sel, l->h, conn_select_bench_block, sizeof(conn_select_bench_block)) == espOK) {
+            active++;
+        } else {
+            l->send_failed = 1;
+            send_failed++;
+        }
+    }
+    printf("Benchmark started on %d connections\r\n", (int)active);
+
+    start = esp_sys_now();
+    while ((time = esp_sys_now() - start) < CONN_SELECT_BENCH_DURATION) {
+        if (conn_select_wait(&sel, &h, &flags, CONN_SELECT_BENCH_DURATION - time) != espOK || h == CONN_SELECT_HANDLE_INVALID) {
+            continue;
+        }
+        events++;
+        l = CONN_SELECT_HANDLE_NUM(h) < ESP_CFG_MAX_CONNS ? by_num[CONN_SELECT_HANDLE_NUM(h)] : NULL;
+        if (l == NULL || l->h != h) {
+            stale++;                            /* Connection number reused or not started by benchmark */
+            continue;
+        }
+        if (flags & CONN_SELECT_READABLE) {
+            if ((p = conn_select_receive(&sel, h)) != NULL) {
+                l->rx += esp_pbuf_length(p, 1);
+                esp_pbuf_free(p);
+            }
+        }
+        if (flags & CONN_SELECT_SENT) {         /* Keep next block in flight */
+            l->tx += sizeof(conn_select_bench_block);
+            if (conn_select_send(&sel, h, conn_select_bench_block, sizeof(conn_select_bench_block)) != espOK) {
+                l->send_failed = 1;             /* Nothing in flight anymore, throughput of link is not valid */
+                send_failed++;
+            }
+        }
+        if (flags & (CONN_SELECT_CLOSED | CONN_SELECT_ERROR)) {
+            conn_select_close(&sel, h);
+            l->h = CONN_SELECT_HANDLE_INVALID;
+        }
+    }
+    time = esp_sys_now() - start;
+
+    /* Report results */
+    for (size_t i = 0; i < ESP_ARRAYSIZE(links); i++) {
+        l = &links[i];
+        printf("Connection %d: sent %d bytes, received %d bytes%s\r\n", (int)i, (int)l->tx, (int)l->rx,
+            l->send_failed ? ", stopped after send failed to queue" : "");
+        tx += l->tx;
+        rx += l->rx;
+        conn_select_close(&sel, l->h);          /* Stale or invalid handle is ignored */
+    }
+    time = ESP_MAX(time, 1);
+    printf("Total: sent %d B/s, received %d B/s, %d events/s, %d stale events, %d failed sends\r\n",
+        (int)(tx * 1000 / time), (int)(rx * 1000 / time), (int)(events * 1000 / time), (int)stale, (int)send_failed);
+
+    conn_select_deinit(&sel);
+    esp_sys_thread_terminate(NULL);
+}
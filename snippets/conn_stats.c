@@ -0,0 +1,151 @@
+/*
+ * Connection statistics collect traffic counters of single connection.
+ *
+ * Functions only update counters, caller is responsible for locking
+ * and for calling them from connection events.
+ * Send latency is measured from start of every send operation until device reports result of it.
+ * Start times of pipelined operations are kept in small FIFO, device reports results in order.
+ * Operations started while FIFO is full are counted but not timed.
+ */
+#include "conn_stats.h"
+
+/**
+ * \brief           Reset all statistics
+ * \param[in]       st: Statistics handle
+ */
+void
+conn_stats_reset(conn_stats_t* st) {
+    memset(st, 0x00, sizeof(*st));
+}
+
+/**
+ * \brief           Count received `+IPD` chunk
+ * \param[in]       st: Statistics handle
+ * \param[in]       len: Chunk length in units of bytes
+ */
+void
+conn_stats_recv(conn_stats_t* st, size_t len) {
+    size_t i;
+
+    for (i = 0; i < CONN_STATS_IPD_BUCKETS - 1 && len > ((size_t)64 << i); i++) {}
+    st->ipd_hist[i]++;
+    st->ipd_cnt++;
+    st->bytes_in += len;
+}
+
+/**
+ * \brief           Count started send operation
+ * \param[in]       st: Statistics handle
+ * \param[in]       len: Number of bytes to send
+ * \param[in]       retry: Set to `1` when caller sends data again after failed send operation
+ */
+void
+conn_stats_send_start(conn_stats_t* st, size_t len, uint8_t retry) {
+    /* Time only when all older operations in progress are timed, FIFO stays in order */
+    if (st->send_times_cnt == st->sends_pending && st->send_times_cnt < CONN_STATS_SEND_FIFO) {
+        st->send_times[(st->send_times_head + st->send_times_cnt) % CONN_STATS_SEND_FIFO] = esp_sys_now();
+        st->send_times_cnt++;
+    }
+    st->sends_pending++;
+    if (retry) {
+        st->retries++;
+    }
+    st->sends++;
+    st->frames += (len + ESP_CFG_CONN_MAX_DATA_LEN - 1) / ESP_CFG_CONN_MAX_DATA_LEN;
+}
+
+/**
+ * \brief           Undo send operation which could not be started
+ *
+ *                  Use when send command failed to queue after \ref conn_stats_send_start.
+ *                  Newest operation in progress is removed, counters are restored
+ *
+ * \param[in]       st: Statistics handle
+ * \param[in]       len: Number of bytes passed to \ref conn_stats_send_start
+ * \param[in]       retry: Retry flag passed to \ref conn_stats_send_start
+ */
+void
+conn_stats_send_cancel(conn_stats_t* st, size_t len, uint8_t retry) {
+    if (st->sends_pending == 0) {
+        return;
+    }
+    if (st->send_times_cnt == st->sends_pending) {  /* Newest operation is timed, drop its start time */
+        st->send_times_cnt--;
+    }
+    st->sends_pending--;
+    if (retry) {
+        st->retries--;
+    }
+    st->sends--;
+    st->frames -= (len + ESP_CFG_CONN_MAX_DATA_LEN - 1) / ESP_CFG_CONN_MAX_DATA_LEN;
+}
+
+/**
+ * \brief           Count finished send operation
+ * \param[in]       st: Statistics handle
+ * \param[in]       res: Result of send operation
+ * \param[in]       len: Number of bytes sent
+ */
+void
+conn_stats_send_done(conn_stats_t* st, espr_t res, size_t len) {
+    uint32_t latency;
+
+    if (res == espOK) {
+        st->bytes_out += len;
+        st->sends_ok++;
+    } else {
+        st->errors++;
+    }
+    if (st->sends_pending == 0) {               /* Send not started through statistics, latency is unknown */
+        st->sends++;
+        st->frames += (len + ESP_CFG_CONN_MAX_DATA_LEN - 1) / ESP_CFG_CONN_MAX_DATA_LEN;
+        return;
+    }
+    st->sends_pending--;
+    if (st->send_times_cnt > 0) {               /* Oldest operation in progress, it has finished now */
+        latency = esp_sys_now() - st->send_times[st->send_times_head];
+        st->send_times_head = (st->send_times_head + 1) % CONN_STATS_SEND_FIFO;
+        st->send_times_cnt--;
+        st->latency_total += latency;
+        st->sends_timed++;
+        if (latency > st->latency_max) {
+            st->latency_max = latency;
+        }
+    }
+}
+
+/**
+ * \brief           Get average send latency
+ *
+ *                  Only send operations started with \ref conn_stats_send_start are included
+ *
+ * \param[in]       st: Statistics handle
+ * \return          Average latency in units of milliseconds
+ */
+uint32_t
+conn_stats_get_latency_avg(const conn_stats_t* st) {
+    return st->sends_timed > 0 ? st->latency_total / st->sends_timed : 0;
+}
+
+/**
+ * \brief           Print statistics of single connection
+ * \param[in]       num: Connection number
+ * \param[in]       st: Statistics handle
+ */
+void
+conn_stats_print(int8_t num, const conn_stats_t* st) {
+    printf("Conn %d: in %d B, out %d B, queued %d B, IPD %d, frames %d, sends %d/%d, "
+            "latency avg %d ms max %d ms, errors %d, retries %d\r\n",
+        (int)num, (int)st->bytes_in, (int)st->bytes_out, (int)st->queued, (int)st->ipd_cnt,
+        (int)st->frames, (int)st->sends_ok, (int)st->sends,
+        (int)conn_stats_get_latency_avg(st), (int)st->latency_max, (int)st->errors, (int)st->retries);
+    printf("Conn %d: IPD sizes", (int)num);
+    for (size_t i = 0; i < CONN_STATS_IPD_BUCKETS; i++) {
+        if (i < CONN_STATS_IPD_BUCKETS - 1) {
+            printf(" <=%d: %d", (int)(64 << i), (int)st->ipd_hist[i]);
+        } else {
+            printf(" >%d: %d", (int)(64 << (i - 1)), (int)st->ipd_hist[i]);
+        }
+    }
+    printf("\r\n");
+}
@@ -0,0 +1,279 @@
+/*
+ * Device state keeps cached copy of station status,
+ * updated only from events reported by library.
+ *
+ * Status getters read cached copy without locking and without AT commands,
+ * therefore they can be called in tight loops from any thread.
+ *
+ * State is protected by sequence counter. Writer increases it before and after update,
+ * reader repeats copy until counter is even and has not changed during copy.
+ * After DEVICE_STATE_READ_RETRIES failed attempts, reader takes system protection,
+ * which waits for writer to finish, instead of spinning against preempted writer.
+ * Counter also serves as state version, increased by every update.
+ *
+ * IP address is refreshed when station gets IP, when join command succeeds
+ * and when library finishes reading station IP address.
+ */
+#include "device_state.h"
+#include "evt_mux.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__ICCARM__)
+#include <intrinsics.h>
+#endif /* defined(__ICCARM__) */
+
+/**
+ * \brief           Memory barrier between sequence counter and state access
+ */
+#if defined(_MSC_VER)
+#define DEVICE_STATE_BARRIER()          _ReadWriteBarrier()
+#elif defined(__CC_ARM)
+#define DEVICE_STATE_BARRIER()          __dmb(0xF)
+#elif defined(__ICCARM__)
+#define DEVICE_STATE_BARRIER()          __DMB()
+#else
+#define DEVICE_STATE_BARRIER()          __sync_synchronize()
+#endif
+
+/**
+ * \brief           Sequence counter, odd while update is in progress
+ */
+static volatile uint32_t
+device_state_seq;
+
+/**
+ * \brief           Cached state
+ */
+static device_state_t
+device_state;
+
+/**
+ * \brief           Set to `1` once event function is registered
+ */
+static uint8_t
+device_state_registered;
+
+/**
+ * \brief           Start state update
+ * \note            Updates are serialized with system protection
+ */
+static void
+device_state_write_begin(void) {
+    esp_sys_protect();
+    device_state_seq++;
+    DEVICE_STATE_BARRIER();
+}
+
+/**
+ * \brief           Finish state update
+ */
+static void
+device_state_write_end(void) {
+    DEVICE_STATE_BARRIER();
+    device_state_seq++;
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Clear station connection part of state
+ * \note            Function must be called between \ref device_state_write_begin and \ref device_state_write_end
+ */
+static void
+device_state_clear_sta(void) {
+    device_state.joined = 0;
+    device_state.has_ip = 0;
+    memset(&device_state.ip, 0x00, sizeof(device_state.ip));
+    memset(&device_state.gw, 0x00, sizeof(device_state.gw));
+    memset(&device_state.nm, 0x00, sizeof(device_state.nm));
+}
+
+/**
+ * \brief           Read station IP address from library
+ * \note            Function must be called between \ref device_state_write_begin and \ref device_state_write_end
+ */
+static void
+device_state_refresh_ip(void) {
+    device_state.has_ip = 0;
+    if (esp_sta_has_ip()) {
+        device_state.has_ip = esp_sta_copy_ip(&device_state.ip, &device_state.gw, &device_state.nm) == espOK;
+    }
+}
+
+/**
+ * \brief           Event function, updating state from unsolicited messages
+ * \param[in]       evt: Event information
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+device_state_evt(esp_evt_t* evt) {
+    switch (esp_evt_get_type(evt)) {
+        case ESP_EVT_WIFI_CONNECTED: {
+            device_state_write_begin();
+            device_state.joined = 1;
+            device_state_write_end();
+            break;
+        }
+        case ESP_EVT_WIFI_GOT_IP:
+        case ESP_EVT_WIFI_IP_ACQUIRED: {
+            device_state_write_begin();
+            device_state.joined = 1;
+            device_state_refresh_ip();
+            device_state_write_end();
+            break;
+        }
+        case ESP_EVT_STA_JOIN_AP: {
+            if (esp_evt_sta_join_ap_get_result(evt) == espOK) {
+                device_state_write_begin();
+                device_state.joined = 1;
+                device_state_refresh_ip();
+                device_state_write_end();
+            }
+            break;
+        }
+        case ESP_EVT_WIFI_DISCONNECTED: {
+            device_state_write_begin();
+            device_state_clear_sta();
+            device_state_write_end();
+            break;
+        }
+        case ESP_EVT_RESET_DETECTED:
+        case ESP_EVT_RESET: {
+            device_state_write_begin();
+            device_state_clear_sta();
+#if ESP_CFG_MODE_ACCESS_POINT
+            device_state.ap_sta_cnt = 0;
+#endif /* ESP_CFG_MODE_ACCESS_POINT */
+            device_state_write_end();
+            break;
+        }
+#if ESP_CFG_MODE_ACCESS_POINT
+        case ESP_EVT_AP_CONNECTED_STA: {
+            device_state_write_begin();
+            device_state.ap_sta_cnt++;
+            device_state_write_end();
+            break;
+        }
+        case ESP_EVT_AP_DISCONNECTED_STA: {
+            device_state_write_begin();
+            if (device_state.ap_sta_cnt > 0) {
+                device_state.ap_sta_cnt--;
+            }
+            device_state_write_end();
+            break;
+        }
+#endif /* ESP_CFG_MODE_ACCESS_POINT */
+        default: break;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Start tracking device state
+ *
+ *                  Function registers event function and reads current status once.
+ *                  It may be called multiple times, only first call has effect
+ *
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+device_state_init(void) {
+    espr_t res = espOK;
+
+    esp_sys_protect();
+    if (!device_state_registered) {
+        res = evt_mux_register(device_state_evt,
+            EVT_MUX_MASK(ESP_EVT_WIFI_CONNECTED) | EVT_MUX_MASK(ESP_EVT_WIFI_GOT_IP)
+            | EVT_MUX_MASK(ESP_EVT_WIFI_IP_ACQUIRED) | EVT_MUX_MASK(ESP_EVT_STA_JOIN_AP)
+            | EVT_MUX_MASK(ESP_EVT_WIFI_DISCONNECTED) | EVT_MUX_MASK(ESP_EVT_RESET_DETECTED)
+            | EVT_MUX_MASK(ESP_EVT_RESET)
+#if ESP_CFG_MODE_ACCESS_POINT
+            | EVT_MUX_MASK(ESP_EVT_AP_CONNECTED_STA) | EVT_MUX_MASK(ESP_EVT_AP_DISCONNECTED_STA)
+#endif /* ESP_CFG_MODE_ACCESS_POINT */
+        );
+        if (res == espOK) {
+            device_state_registered = 1;
+
+            /* Initial state, later updated by events only */
+            device_state_write_begin();
+            device_state_clear_sta();
+            device_state.joined = esp_sta_is_joined();
+            device_state_refresh_ip();
+            device_state_write_end();
+        }
+    }
+    esp_sys_unprotect();
+    return res;
+}
+
+/**
+ * \brief           Get consistent copy of device state
+ * \param[out]      st: Output variable to copy state to
+ * \return          State version, increased on every update
+ */
+uint32_t
+device_state_get(device_state_t* st) {
+    uint32_t s1, s2;
+
+    for (size_t i = 0; i < DEVICE_STATE_READ_RETRIES; i++) {
+        s1 = device_state_seq;
+        DEVICE_STATE_BARRIER();
+        memcpy(st, &device_state, sizeof(*st));
+        DEVICE_STATE_BARRIER();
+        s2 = device_state_seq;
+        if (!(s1 & 0x01) && s1 == s2) {
+            return s1 >> 1;
+        }
+    }
+
+    /* Writer is probably preempted in the middle of update, wait for it */
+    esp_sys_protect();
+    memcpy(st, &device_state, sizeof(*st));
+    s1 = device_state_seq;
+    esp_sys_unprotect();
+    return s1 >> 1;
+}
+
+/**
+ * \brief           Get state version
+ *
+ *                  Version is increased on every update. Compare it with previous value
+ *                  to check if state has changed, without copying it
+ *
+ * \return          State version
+ */
+uint32_t
+device_state_version(void) {
+    return device_state_seq >> 1;
+}
+
+/**
+ * \brief           Check if station is connected to access point
+ * \return          `1` if connected, `0` otherwise
+ */
+uint8_t
+device_state_is_joined(void) {
+    return *(volatile uint8_t *)&device_state.joined;
+}
+
+/**
+ * \brief           Check if station has IP address
+ * \return          `1` if station has IP, `0` otherwise
+ */
+uint8_t
+device_state_has_ip(void) {
+    return *(volatile uint8_t *)&device_state.has_ip;
+}
+
+/**
+ * \brief           Copy station IP address
+ * \param[out]      ip: Output variable to copy IP address to
+ * \return          `1` if station has IP address, `0` otherwise
+ */
+uint8_t
+device_state_copy_ip(esp_ip_t* ip) {
+    device_state_t st;
+
+    device_state_get(&st);
+    *ip = st.ip;
+    return st.has_ip;
+}
@@ -0,0 +1,411 @@
+/*
+ * Event multiplexer delivers global events only to listeners interested in them.
+ *
+ * Multiplexer registers single function to library and every listener
+ * registers to multiplexer with mask of event types it wants to receive.
+ * For every event type, set of interested listeners is computed once, on registration,
+ * therefore dispatching an event only calls listeners from its set,
+ * without calling every listener to filter events with switch statement.
+ *
+ * Listeners run from library processing thread, so slow listener delays
+ * processing of data received from device. Listeners registered as deferred
+ * are called from user worker thread instead: event is copied to bounded queue
+ * and processing thread continues immediately. Keep latency critical events,
+ * such as received connection data, as inline listeners.
+ * Deferred listener receives copy of event structure, data referenced
+ * by pointers in event may already be released when listener is called.
+ */
+#include "evt_mux.h"
+
+#if EVT_MUX_MAX_LISTENERS > 16
+#error "EVT_MUX_MAX_LISTENERS must not be greater than 16"
+#endif
+
+/**
+ * \brief           Set of listeners, bit `i` represents listener at index `i`
+ */
+typedef uint16_t evt_mux_set_t;
+
+/**
+ * \brief           Single listener
+ */
+typedef struct {
+    esp_evt_fn fn;                              /*!< Listener function or `NULL` if entry is free */
+    evt_mux_mask_t mask;                        /*!< Mask of event types listener is interested in */
+    uint8_t deferred;                           /*!< Set to `1` when listener is called from worker thread */
+} evt_mux_listener_t;
+
+/**
+ * \brief           Event waiting in deferred queue
+ */
+typedef struct {
+    esp_evt_t evt;                              /*!< Copy of event */
+    uint32_t time;                              /*!< Time when event was put to queue */
+} evt_mux_entry_t;
+
+/**
+ * \brief           Registered listeners
+ */
+static evt_mux_listener_t
+listeners[EVT_MUX_MAX_LISTENERS];
+
+/**
+ * \brief           Precomputed set of inline listeners for every event type
+ */
+static evt_mux_set_t
+by_type[EVT_MUX_TYPES];
+
+/**
+ * \brief           Set of inline listeners interested in all events, used for unknown event types
+ */
+static evt_mux_set_t
+by_type_other;
+
+/**
+ * \brief           Precomputed set of deferred listeners for every event type
+ */
+static evt_mux_set_t
+by_type_deferred[EVT_MUX_TYPES];
+
+/**
+ * \brief           Set of deferred listeners interested in all events, used for unknown event types
+ */
+static evt_mux_set_t
+by_type_deferred_other;
+
+/**
+ * \brief           Deferred event queue
+ */
+static evt_mux_entry_t
+queue[EVT_MUX_QUEUE_LEN];
+
+/**
+ * \brief           Index of oldest event in queue
+ */
+static size_t
+queue_r;
+
+/**
+ * \brief           Released when new event is put to queue
+ */
+static esp_sys_sem_t
+queue_sem;
+
+/**
+ * \brief           Deferred dispatch statistics
+ */
+static evt_mux_stats_t
+stats;
+
+/**
+ * \brief           Set to `1` once dispatch function is registered to library
+ */
+static uint8_t
+registered;
+
+/**
+ * \brief           Recompute listener set of every event type
+ * \note            Function must be called with system protection
+ */
+static void
+evt_mux_rebuild(void) {
+    evt_mux_set_t* sets;
+    evt_mux_set_t* other;
+
+    memset(by_type, 0x00, sizeof(by_type));
+    memset(by_type_deferred, 0x00, sizeof(by_type_deferred));
+    by_type_other = 0;
+    by_type_deferred_other = 0;
+    for (size_t i = 0; i < EVT_MUX_MAX_LISTENERS; i++) {
+        if (listeners[i].fn == NULL) {
+            continue;
+        }
+        sets = listeners[i].deferred ? by_type_deferred : by_type;
+        other = listeners[i].deferred ? &by_type_deferred_other : &by_type_other;
+        for (size_t t = 0; t < EVT_MUX_TYPES; t++) {
+            if (listeners[i].mask & EVT_MUX_MASK(t)) {
+                sets[t] |= (evt_mux_set_t)1 << i;
+            }
+        }
+        if (listeners[i].mask == EVT_MUX_MASK_ALL) {
+            *other |= (evt_mux_set_t)1 << i;
+        }
+    }
+}
+
+/**
+ * \brief           Dispatch function, registered to library
+ * \param[in]       evt: Event information
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+evt_mux_dispatch(esp_evt_t* evt) {
+    esp_evt_type_t type;
+    evt_mux_set_t set;
+    size_t i;
+
+    type = esp_evt_get_type(evt);
+    esp_sys_protect();
+    set = (size_t)type < EVT_MUX_TYPES ? by_type[type] : by_type_other;
+    for (i = 0; set != 0; i++, set >>= 1) {
+        if (set & 0x01) {
+            listeners[i].fn(evt);
+        }
+    }
+
+    /* Copy event to queue for deferred listeners */
+    set = (size_t)type < EVT_MUX_TYPES ? by_type_deferred[type] : by_type_deferred_other;
+    if (set != 0) {
+        if (stats.depth < EVT_MUX_QUEUE_LEN) {
+            i = (queue_r + stats.depth) % EVT_MUX_QUEUE_LEN;
+            queue[i].evt = *evt;
+            queue[i].time = esp_sys_now();
+            stats.queued++;
+            if (++stats.depth > stats.depth_max) {
+                stats.depth_max = stats.depth;
+            }
+            esp_sys_sem_release(&queue_sem);
+        } else {
+            stats.dropped++;
+        }
+    }
+    esp_sys_unprotect();
+    return espOK;
+}
+
+/**
+ * \brief           Create deferred queue semaphore if not yet created
+ * \note            Function must be called with system protection
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+evt_mux_queue_init(void) {
+    if (!esp_sys_sem_isvalid(&queue_sem)) {
+        if (!esp_sys_sem_create(&queue_sem, 0)) {
+            return espERRMEM;
+        }
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Add listener or update existing one
+ * \param[in]       fn: Listener function
+ * \param[in]       mask: Mask of event types
+ * \param[in]       deferred: Set to `1` to call listener from worker thread
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+evt_mux_add(esp_evt_fn fn, evt_mux_mask_t mask, uint8_t deferred) {
+    evt_mux_listener_t* free_l = NULL;
+    espr_t res = espOK;
+    size_t i;
+
+    if (fn == NULL) {
+        return espPARERR;
+    }
+    esp_sys_protect();
+    if (deferred) {
+        res = evt_mux_queue_init();
+    }
+    if (res == espOK && !registered) {
+        if ((res = esp_evt_register(evt_mux_dispatch)) == espOK) {
+            registered = 1;
+        }
+    }
+    if (res == espOK) {
+        for (i = 0; i < EVT_MUX_MAX_LISTENERS; i++) {
+            if (listeners[i].fn == fn) {
+                break;
+            } else if (listeners[i].fn == NULL && free_l == NULL) {
+                free_l = &listeners[i];
+            }
+        }
+        if (i < EVT_MUX_MAX_LISTENERS) {
+            free_l = &listeners[i];             /* Update existing listener */
+        }
+        if (free_l != NULL) {
+            free_l->fn = fn;
+            free_l->mask = mask;
+            free_l->deferred = deferred;
+        } else {
+            res = espERRMEM;
+        }
+        evt_mux_rebuild();
+    }
+    esp_sys_unprotect();
+    return res;
+}
+
+/**
+ * \brief           Register listener for selected event types
+ *
+ *                  Listener is called from library processing thread.
+ *                  When function is already registered, its mask is replaced
+ *
+ * \param[in]       fn: Listener function
+ * \param[in]       mask: Mask of event types, built with \ref EVT_MUX_MASK or \ref EVT_MUX_MASK_ALL
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+evt_mux_register(esp_evt_fn fn, evt_mux_mask_t mask) {
+    return evt_mux_add(fn, mask, 0);
+}
+
+/**
+ * \brief           Register deferred listener for selected event types
+ *
+ *                  Listener is called from thread calling \ref evt_mux_process
+ *                  with copy of event. When queue is full, event is dropped for deferred listeners.
+ *                  When function is already registered, its mask is replaced
+ *
+ * \param[in]       fn: Listener function, return value is ignored
+ * \param[in]       mask: Mask of event types, built with \ref EVT_MUX_MASK or \ref EVT_MUX_MASK_ALL
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+evt_mux_register_deferred(esp_evt_fn fn, evt_mux_mask_t mask) {
+    return evt_mux_add(fn, mask, 1);
+}
+
+/**
+ * \brief           Unregister listener
+ * \param[in]       fn: Listener function
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+evt_mux_unregister(esp_evt_fn fn) {
+    espr_t res = espERR;
+
+    esp_sys_protect();
+    for (size_t i = 0; i < EVT_MUX_MAX_LISTENERS; i++) {
+        if (listeners[i].fn == fn) {
+            listeners[i].fn = NULL;
+            listeners[i].mask = 0;
+            listeners[i].deferred = 0;
+            res = espOK;
+        }
+    }
+    evt_mux_rebuild();
+    esp_sys_unprotect();
+    return res;
+}
+
+/**
+ * \brief           Wait for deferred events and call deferred listeners
+ *
+ *                  Function shall be called from user worker thread,
+ *                  it returns once queue is empty
+ *
+ * \param[in]       timeout: Maximal time to wait for first event in units of milliseconds,
+ *                      use `0` to wait forever
+ * \return          Number of dispatched events
+ */
+size_t
+evt_mux_process(uint32_t timeout) {
+    esp_evt_fn fns[EVT_MUX_MAX_LISTENERS];
+    evt_mux_entry_t e;
+    esp_evt_type_t type;
+    evt_mux_set_t set;
+    size_t i, n, cnt = 0;
+    uint32_t lag;
+
+    esp_sys_protect();
+    if (evt_mux_queue_init() != espOK) {
+        esp_sys_unprotect();
+        return 0;
+    }
+    esp_sys_unprotect();
+
+    if (esp_sys_sem_wait(&queue_sem, timeout) == ESP_SYS_TIMEOUT) {
+        return 0;
+    }
+    while (1) {
+        esp_sys_protect();
+        if (stats.depth == 0) {
+            esp_sys_unprotect();
+            break;
+        }
+        e = queue[queue_r];
+        queue_r = (queue_r + 1) % EVT_MUX_QUEUE_LEN;
+        stats.depth--;
+
+        /* Take listeners while protected, call them without protection */
+        type = esp_evt_get_type(&e.evt);
+        set = (size_t)type < EVT_MUX_TYPES ? by_type_deferred[type] : by_type_deferred_other;
+        for (i = 0, n = 0; set != 0; i++, set >>= 1) {
+            if (set & 0x01) {
+                fns[n++] = listeners[i].fn;
+            }
+        }
+        lag = esp_sys_now() - e.time;
+        stats.lag_total += lag;
+        if (lag > stats.lag_max) {
+            stats.lag_max = lag;
+        }
+        stats.dispatched++;
+        esp_sys_unprotect();
+
+        for (i = 0; i < n; i++) {
+            fns[i](&e.evt);
+        }
+        cnt++;
+    }
+    return cnt;
+}
+
+/**
+ * \brief           Get deferred dispatch statistics
+ * \param[out]      st: Output variable to save statistics to
+ */
+void
+evt_mux_get_stats(evt_mux_stats_t* st) {
+    esp_sys_protect();
+    *st = stats;
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Worker thread calling deferred listeners
+ * \param[in]       arg: Thread argument, not used
+ */
+void
+evt_mux_thread(void const* arg) {
+    while (1) {
+        evt_mux_process(0);
+    }
+}
+
+/**
+ * \brief           Deferred listener printing WIFI events and dispatch lag
+ * \param[in]       evt: Copy of event information
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+evt_mux_deferred_print(esp_evt_t* evt) {
+    evt_mux_stats_t st;
+
+    evt_mux_get_stats(&st);
+    printf("Deferred event %d, lag max: %d ms, dropped: %d\r\n",
+        (int)esp_evt_get_type(evt), (int)st.lag_max, (int)st.dropped);
+    return espOK;
+}
+
+/**
+ * \brief           Example thread with deferred listener for WIFI events
+ *
+ * Listener is registered on top of global event callback,
+ * it runs in this thread instead of library processing thread
+ *
+ * \param[in]       arg: Thread argument, not used
+ */
+void
+evt_mux_deferred_thread(void const* arg) {
+    if (evt_mux_register_deferred(evt_mux_deferred_print, EVT_MUX_MASK(ESP_EVT_WIFI_GOT_IP)
+            | EVT_MUX_MASK(ESP_EVT_WIFI_CONNECTED) | EVT_MUX_MASK(ESP_EVT_WIFI_DISCONNECTED)) != espOK) {
+        printf("Cannot register deferred listener\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    evt_mux_thread(arg);
+}
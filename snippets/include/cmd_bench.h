@@ -0,0 +1,54 @@
+#ifndef __CMD_BENCH_H
+#define __CMD_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Number of commands executed in every benchmark phase
+ */
+#ifndef CMD_BENCH_ITERATIONS
+#define CMD_BENCH_ITERATIONS            100
+#endif
+
+/**
+ * \brief           Use AT command trace to split round-trip time
+ *                  to time spent on AT port and time spent in thread handoffs
+ * \note            Trace must be fed from low-level layer, see \ref cmd_trace_tx.
+ *                  Trace clock must be the same as benchmark clock: define \ref CMD_TRACE_NOW
+ *                  as \ref cmd_bench_now_us and \ref CMD_TRACE_UNIT as `"us"`
+ */
+#ifndef CMD_BENCH_TRACE
+#define CMD_BENCH_TRACE                 0
+#endif
+
+/**
+ * \brief           Name of benchmark command in AT command trace
+ */
+#ifndef CMD_BENCH_TRACE_NAME
+#define CMD_BENCH_TRACE_NAME            "CWHOSTNAME"
+#endif
+
+/**
+ * \brief           Optional high-resolution counter used by \ref cmd_bench_now_us on non-Win32 platforms
+ *
+ *                  Define it together with `CMD_BENCH_CYCLES_PER_US`, for example to `DWT->CYCCNT`
+ *                  and `(SystemCoreClock / 1000000)` on Cortex-M, with cycle counter enabled.
+ *                  When not defined, \ref esp_sys_now is used with resolution of 1 ms
+ */
+#if __DOXYGEN__
+#define CMD_BENCH_CYCLES()              DWT->CYCCNT
+#define CMD_BENCH_CYCLES_PER_US         (SystemCoreClock / 1000000)
+#endif
+
+uint32_t    cmd_bench_now_us(void);
+void        cmd_bench_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __CMD_FUTURE_H
+#define __CMD_FUTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Completion object of single non-blocking command
+ * \note            Future may be waited for by single thread at a time
+ */
+typedef struct {
+    uint8_t done;                               /*!< Set to `1` once command is finished */
+    espr_t res;                                 /*!< Command result, valid once command is finished */
+    esp_sys_sem_t* notify;                      /*!< Semaphore of waiting thread or `NULL` */
+} cmd_future_t;
+
+/**
+ * \brief           Callback and argument pair for non-blocking API function
+ *
+ *                  Use in place of `evt_fn, evt_arg` parameters,
+ *                  for example `esp_ping(host, &time, CMD_FUTURE_CB(&f), 0)`
+ *
+ * \param[in]       f: Future handle
+ */
+#define CMD_FUTURE_CB(f)                cmd_future_cb, (f)
+
+void        cmd_future_init(cmd_future_t* f);
+void        cmd_future_cb(espr_t res, void* arg);
+void        cmd_future_start(cmd_future_t* f, espr_t res);
+uint8_t     cmd_future_poll(cmd_future_t* f, espr_t* res);
+espr_t      cmd_future_wait(cmd_future_t* f, uint32_t timeout);
+espr_t      cmd_future_wait_any(cmd_future_t* const* f, size_t cnt, size_t* index, uint32_t timeout);
+espr_t      cmd_future_wait_all(cmd_future_t* const* f, size_t cnt, uint32_t timeout);
+
+void        cmd_future_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
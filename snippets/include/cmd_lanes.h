@@ -0,0 +1,153 @@
+#ifndef __CMD_LANES_H
+#define __CMD_LANES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Maximal number of commands waiting in data lane
+ */
+#ifndef CMD_LANES_DATA_DEPTH
+#define CMD_LANES_DATA_DEPTH            8
+#endif
+
+/**
+ * \brief           Maximal number of commands waiting in control lane
+ */
+#ifndef CMD_LANES_CTRL_DEPTH
+#define CMD_LANES_CTRL_DEPTH            4
+#endif
+
+/**
+ * \brief           Maximal number of commands waiting in management lane
+ */
+#ifndef CMD_LANES_MGMT_DEPTH
+#define CMD_LANES_MGMT_DEPTH            2
+#endif
+
+/**
+ * \brief           Time in units of milliseconds after which waiting control command
+ *                  is executed even if data lane is not empty
+ */
+#ifndef CMD_LANES_CTRL_MAX_WAIT
+#define CMD_LANES_CTRL_MAX_WAIT         500
+#endif
+
+/**
+ * \brief           Time in units of milliseconds after which waiting management command
+ *                  is executed even if higher priority lanes are not empty
+ */
+#ifndef CMD_LANES_MGMT_MAX_WAIT
+#define CMD_LANES_MGMT_MAX_WAIT         5000
+#endif
+
+/**
+ * \brief           Enable \ref cmd_trace_enqueue call with lane enqueue time before command is executed,
+ *                  so that AT command trace includes time spent in lane
+ */
+#ifndef CMD_LANES_TRACE
+#define CMD_LANES_TRACE                 0
+#endif
+
+/**
+ * \brief           Command lanes, ordered from highest to lowest priority
+ */
+typedef enum {
+    CMD_LANE_DATA = 0x00,                       /*!< Data path: connection send, receive confirmation, close */
+    CMD_LANE_CTRL,                              /*!< Short control queries: IP, MAC, DNS */
+    CMD_LANE_MGMT,                              /*!< Slow management commands: access point scan, join, ping */
+    CMD_LANE_END,                               /*!< Number of lanes, used for array sizes */
+} cmd_lane_t;
+
+/**
+ * \brief           Command function, executed from dispatcher thread
+ *
+ *                  Function shall call single blocking library API and return its result
+ *
+ * \param[in]       arg: User argument
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+typedef espr_t (*cmd_lanes_fn)(void* arg);
+
+/**
+ * \brief           Cancellation token
+ *
+ *                  Same token may be used for multiple commands,
+ *                  all of them are cancelled with single \ref cmd_lanes_cancel call
+ */
+typedef struct {
+    uint8_t cancelled;                          /*!< Set to `1` once token is cancelled */
+} cmd_lanes_token_t;
+
+/**
+ * \brief           Command waiting in a lane
+ */
+typedef struct cmd_lanes_cmd {
+    struct cmd_lanes_cmd* next;                 /*!< Next command in the same lane */
+    cmd_lanes_fn fn;                            /*!< Command function */
+    void* arg;                                  /*!< User argument for command function */
+    cmd_lane_t lane;                            /*!< Lane command was put to */
+    uint32_t time;                              /*!< Time when command was put to lane */
+#if CMD_LANES_TRACE
+    uint32_t trace_time;                        /*!< Time when command was put to lane, from \ref CMD_TRACE_NOW */
+#endif /* CMD_LANES_TRACE */
+    uint32_t timeout;                           /*!< Maximal time from enqueue to execution, `0` if not used */
+    cmd_lanes_token_t* token;                   /*!< Optional cancellation token */
+    espr_t res;                                 /*!< Command result */
+    esp_sys_sem_t sem;                          /*!< Released by dispatcher when command is finished */
+} cmd_lanes_cmd_t;
+
+/**
+ * \brief           Lane statistics
+ */
+typedef struct {
+    uint32_t submitted;                         /*!< Number of commands put to lane */
+    uint32_t rejected;                          /*!< Number of commands rejected because lane was full */
+    uint32_t executed;                          /*!< Number of executed commands */
+    uint32_t promoted;                          /*!< Number of commands executed before higher priority lanes because of maximal wait time */
+    uint32_t expired;                           /*!< Number of commands dropped because deadline passed before execution */
+    uint32_t cancelled;                         /*!< Number of commands dropped because token was cancelled */
+    uint32_t depth;                             /*!< Current number of commands in lane */
+    uint32_t depth_max;                         /*!< Maximal number of commands in lane */
+    uint32_t wait_total;                        /*!< Sum of lane wait times in units of milliseconds */
+    uint32_t wait_max;                          /*!< Maximal lane wait time in units of milliseconds */
+} cmd_lanes_stats_t;
+
+/**
+ * \brief           Single lane
+ */
+typedef struct {
+    cmd_lanes_cmd_t* head;                      /*!< Oldest command in lane */
+    cmd_lanes_cmd_t* tail;                      /*!< Newest command in lane */
+    size_t depth;                               /*!< Maximal number of commands in lane */
+    uint32_t max_wait;                          /*!< Maximal wait time before command is promoted, `0` to disable */
+    cmd_lanes_stats_t stats;                    /*!< Lane statistics */
+} cmd_lanes_lane_t;
+
+/**
+ * \brief           Priority command lanes with single dispatcher thread
+ */
+typedef struct {
+    cmd_lanes_lane_t lanes[CMD_LANE_END];       /*!< Lanes ordered by priority */
+    esp_sys_sem_t work;                         /*!< Released when new command is put to any lane */
+} cmd_lanes_t;
+
+espr_t      cmd_lanes_init(cmd_lanes_t* cl, size_t stack_size);
+void        cmd_lanes_set_policy(cmd_lanes_t* cl, cmd_lane_t lane, size_t depth, uint32_t max_wait);
+espr_t      cmd_lanes_call(cmd_lanes_t* cl, cmd_lane_t lane, cmd_lanes_fn fn, void* arg);
+espr_t      cmd_lanes_call_ex(cmd_lanes_t* cl, cmd_lane_t lane, cmd_lanes_fn fn, void* arg,
+                              uint32_t timeout, cmd_lanes_token_t* token);
+void        cmd_lanes_token_init(cmd_lanes_token_t* token);
+void        cmd_lanes_cancel(cmd_lanes_t* cl, cmd_lanes_token_t* token);
+void        cmd_lanes_get_stats(cmd_lanes_t* cl, cmd_lane_t lane, cmd_lanes_stats_t* stats);
+
+void        cmd_lanes_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
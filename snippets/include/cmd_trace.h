@@ -0,0 +1,116 @@
+#ifndef __CMD_TRACE_H
+#define __CMD_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Maximal number of traced AT command types
+ *
+ *                  Commands not fitting to table are counted as type `OTHER`
+ */
+#ifndef CMD_TRACE_TYPES
+#define CMD_TRACE_TYPES                 12
+#endif
+
+/**
+ * \brief           Maximal length of AT command name, including termination
+ */
+#ifndef CMD_TRACE_NAME_LEN
+#define CMD_TRACE_NAME_LEN              12
+#endif
+
+/**
+ * \brief           Number of last commands kept in trace ring buffer
+ */
+#ifndef CMD_TRACE_RING_LEN
+#define CMD_TRACE_RING_LEN              16
+#endif
+
+/**
+ * \brief           Get current trace time
+ *
+ *                  All trace times, latencies and \ref CMD_TRACE_TIMEOUT are in units of this clock.
+ *                  Default is \ref esp_sys_now in units of milliseconds.
+ *                  Define it together with \ref CMD_TRACE_UNIT to high-resolution counter,
+ *                  such as \ref cmd_bench_now_us, to trace short commands.
+ *                  \ref CMD_TRACE_TIMEOUT must then be redefined in the same units
+ */
+#ifndef CMD_TRACE_NOW
+#define CMD_TRACE_NOW()                 esp_sys_now()
+#endif
+
+/**
+ * \brief           Unit of \ref CMD_TRACE_NOW clock, used in printed statistics
+ */
+#ifndef CMD_TRACE_UNIT
+#define CMD_TRACE_UNIT                  "ms"
+#endif
+
+/**
+ * \brief           Time in units of \ref CMD_TRACE_NOW after which send command without
+ *                  final response is dropped when next command is sent
+ */
+#ifndef CMD_TRACE_TIMEOUT
+#define CMD_TRACE_TIMEOUT               60000
+#endif
+
+/**
+ * \brief           Number of latency histogram buckets
+ *
+ *                  Bucket `0` counts `0`, bucket `i` counts latencies
+ *                  from `1 << (i - 1)` to `(1 << i) - 1` units of \ref CMD_TRACE_NOW, last bucket counts all larger latencies
+ */
+#define CMD_TRACE_HIST_BUCKETS          16
+
+/**
+ * \brief           Latency histogram
+ */
+typedef struct {
+    uint32_t min;                               /*!< Minimal latency in units of \ref CMD_TRACE_NOW */
+    uint32_t max;                               /*!< Maximal latency in units of \ref CMD_TRACE_NOW */
+    uint32_t total;                             /*!< Sum of latencies in units of \ref CMD_TRACE_NOW */
+    uint32_t hist[CMD_TRACE_HIST_BUCKETS];      /*!< Number of latencies per bucket */
+} cmd_trace_hist_t;
+
+/**
+ * \brief           Statistics of single AT command type
+ */
+typedef struct {
+    char name[CMD_TRACE_NAME_LEN];              /*!< Command name without `AT+` prefix, such as `CIPSEND` */
+    uint32_t count;                             /*!< Number of finished commands */
+    uint32_t errors;                            /*!< Number of commands finished with error or dropped */
+    cmd_trace_hist_t queue;                     /*!< Time from enqueue to first byte sent to device */
+    cmd_trace_hist_t exec;                      /*!< Time from first byte sent to final response */
+} cmd_trace_stats_t;
+
+/**
+ * \brief           Single traced command in ring buffer
+ */
+typedef struct {
+    uint8_t type;                               /*!< Command type index, use with \ref cmd_trace_get_stats */
+    uint8_t ok;                                 /*!< Set to `1` if command finished with `OK`, `0` otherwise */
+    uint32_t enqueue;                           /*!< Time when command was queued */
+    uint32_t start;                             /*!< Time when first byte of command was sent to device */
+    uint32_t end;                               /*!< Time when final response was received */
+} cmd_trace_entry_t;
+
+void        cmd_trace_enqueue(uint32_t time);
+void        cmd_trace_tx(const void* data, size_t len);
+void        cmd_trace_rx(const void* data, size_t len);
+
+uint8_t     cmd_trace_get_stats(size_t type, cmd_trace_stats_t* stats);
+size_t      cmd_trace_get_last(cmd_trace_entry_t* entries, size_t cnt);
+uint32_t    cmd_trace_hist_avg(const cmd_trace_hist_t* h, uint32_t count);
+uint32_t    cmd_trace_hist_percentile(const cmd_trace_hist_t* h, uint32_t count, uint8_t pct);
+void        cmd_trace_reset(void);
+void        cmd_trace_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
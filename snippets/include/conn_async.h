@@ -0,0 +1,159 @@
+#ifndef __CONN_ASYNC_H
+#define __CONN_ASYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+#include "conn_select.h"
+
+/**
+ * \brief           Task is waiting for operation to complete
+ */
+#define CONN_ASYNC_WAITING              0
+
+/**
+ * \brief           Task has finished and is removed from scheduler
+ */
+#define CONN_ASYNC_EXITED               1
+
+struct conn_async;
+struct conn_async_task;
+
+/**
+ * \brief           Task function, called by scheduler until it returns \ref CONN_ASYNC_EXITED
+ *
+ *                  Function body must be placed between \ref CONN_ASYNC_BEGIN and \ref CONN_ASYNC_END.
+ *                  Local variables are not preserved between calls, keep state in task argument
+ *
+ * \param[in]       t: Task handle
+ * \return          \ref CONN_ASYNC_WAITING or \ref CONN_ASYNC_EXITED
+ */
+typedef uint8_t (*conn_async_fn)(struct conn_async_task* t);
+
+/**
+ * \brief           Stackless task state
+ */
+typedef struct conn_async_task {
+    uint16_t lc;                                /*!< Line where task continues on next call, `0` on start */
+    conn_async_fn fn;                           /*!< Task function */
+    void* arg;                                  /*!< User argument */
+    struct conn_async* s;                       /*!< Scheduler task belongs to */
+    conn_select_handle_t h;                     /*!< Handle of connection task currently operates on */
+    uint8_t flags;                              /*!< Readiness flags of task connection, see `CONN_SELECT_*` */
+    espr_t res;                                 /*!< Result of last operation */
+    conn_select_connect_t req;                  /*!< Client connection request */
+    struct conn_async_task* next;               /*!< Next task in scheduler list */
+} conn_async_task_t;
+
+/**
+ * \brief           Scheduler running all tasks in single thread
+ */
+typedef struct conn_async {
+    conn_select_t sel;                          /*!< Selector of all task connections */
+    conn_async_task_t* tasks;                   /*!< List of active tasks */
+    conn_select_handle_t accepted[ESP_CFG_MAX_CONNS];   /*!< Accepted connections not yet taken by task */
+    size_t accepted_cnt;                        /*!< Number of entries in accepted array */
+} conn_async_t;
+
+/**
+ * \brief           Start of task function body
+ * \param[in]       t: Task handle
+ */
+#define CONN_ASYNC_BEGIN(t)             switch ((t)->lc) { case 0:
+
+/**
+ * \brief           End of task function body, task exits when it gets here
+ * \param[in]       t: Task handle
+ */
+#define CONN_ASYNC_END(t)               } (t)->lc = 0; return CONN_ASYNC_EXITED
+
+/**
+ * \brief           Exit task immediately
+ * \param[in]       t: Task handle
+ */
+#define CONN_ASYNC_EXIT(t)              do { (t)->lc = 0; return CONN_ASYNC_EXITED; } while (0)
+
+/**
+ * \brief           Return to scheduler until condition is true
+ * \note            Only one wait macro is allowed per line of code
+ * \param[in]       t: Task handle
+ * \param[in]       cond: Condition to wait for, evaluated on every scheduler pass
+ */
+#define CONN_ASYNC_WAIT_UNTIL(t, cond)  do { (t)->lc = __LINE__; case __LINE__: if (!(cond)) { return CONN_ASYNC_WAITING; } } while (0)
+
+/**
+ * \brief           Wait for new client connection on server
+ *
+ *                  Accepted connection is available in `h` member of task
+ *
+ * \param[in]       t: Task handle
+ */
+#define CONN_ASYNC_ACCEPT(t)            CONN_ASYNC_WAIT_UNTIL((t), conn_async_try_accept(t))
+
+/**
+ * \brief           Connect to remote host
+ *
+ *                  On success, connection is available in `h` member of task.
+ *                  Result is available in `res` member of task
+ *
+ * \param[in]       t: Task handle
+ * \param[in]       type: Connection type
+ * \param[in]       host: Host name or IP address. String must stay valid until connected
+ * \param[in]       port: Port to connect to
+ */
+#define CONN_ASYNC_CONNECT(t, type, host, port)     do {                \
+    (t)->res = conn_async_connect_start((t), (type), (host), (port));   \
+    if ((t)->res == espOK) {                                            \
+        CONN_ASYNC_WAIT_UNTIL((t), conn_async_connect_done(t));         \
+    }                                                                   \
+} while (0)
+
+/**
+ * \brief           Receive data on task connection
+ *
+ *                  Result is available in `res` member of task,
+ *                  \ref espOK with received chain or \ref espCLOSED with `NULL` chain
+ *
+ * \param[in]       t: Task handle
+ * \param[out]      p: Variable to save received pbuf chain to. User must free it with \ref esp_pbuf_free
+ */
+#define CONN_ASYNC_RECEIVE(t, p)        CONN_ASYNC_WAIT_UNTIL((t), conn_async_try_receive((t), &(p)))
+
+/**
+ * \brief           Write data on task connection and wait until they are sent
+ *
+ *                  Result is available in `res` member of task
+ *
+ * \param[in]       t: Task handle
+ * \param[in]       data: Data to send. Memory must stay valid until write completes
+ * \param[in]       len: Number of bytes to send
+ */
+#define CONN_ASYNC_WRITE(t, data, len)  do {                            \
+    (t)->res = conn_async_write_start((t), (data), (len));              \
+    if ((t)->res == espOK) {                                            \
+        CONN_ASYNC_WAIT_UNTIL((t), conn_async_write_done(t));           \
+    }                                                                   \
+} while (0)
+
+espr_t      conn_async_init(conn_async_t* s);
+espr_t      conn_async_listen(conn_async_t* s, esp_port_t port, uint16_t max_conn);
+void        conn_async_add(conn_async_t* s, conn_async_task_t* t, conn_async_fn fn, void* arg);
+void        conn_async_run(conn_async_t* s);
+espr_t      conn_async_close(conn_async_task_t* t);
+
+uint8_t     conn_async_try_accept(conn_async_task_t* t);
+espr_t      conn_async_connect_start(conn_async_task_t* t, esp_conn_type_t type, const char* host, esp_port_t port);
+uint8_t     conn_async_connect_done(conn_async_task_t* t);
+uint8_t     conn_async_try_receive(conn_async_task_t* t, esp_pbuf_p* p);
+espr_t      conn_async_write_start(conn_async_task_t* t, const void* data, size_t len);
+uint8_t     conn_async_write_done(conn_async_task_t* t);
+
+void        conn_async_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
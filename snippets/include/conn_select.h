@@ -0,0 +1,159 @@
+#ifndef __CONN_SELECT_H
+#define __CONN_SELECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+#include "pbuf_chain.h"
+#include "conn_stats.h"
+
+/**
+ * \brief           New connection has been accepted by server
+ *
+ *                  Flag is not reported for connections already taken with \ref conn_select_accept_many
+ */
+#define CONN_SELECT_ACCEPT              0x01
+
+/**
+ * \brief           Received data are ready to be read with \ref conn_select_receive
+ */
+#define CONN_SELECT_READABLE            0x02
+
+/**
+ * \brief           Connection has been closed by remote side
+ */
+#define CONN_SELECT_CLOSED              0x04
+
+/**
+ * \brief           Client connection started with \ref conn_select_connect is active
+ */
+#define CONN_SELECT_CONNECTED           0x08
+
+/**
+ * \brief           Data sent with \ref conn_select_send have been sent successfully
+ */
+#define CONN_SELECT_SENT                0x10
+
+/**
+ * \brief           Sending data or connecting to remote host failed
+ */
+#define CONN_SELECT_ERROR               0x20
+
+/**
+ * \brief           Free memory in units of bytes below which received data are confirmed
+ *                  only when user has read all data of connection
+ * \note            Used with \ref ESP_CFG_CONN_MANUAL_TCP_RECEIVE only
+ */
+#ifndef CONN_SELECT_RX_MEM_RESERVE
+#define CONN_SELECT_RX_MEM_RESERVE      (4 * ESP_CFG_IPD_MAX_BUFF_SIZE)
+#endif
+
+/**
+ * \brief           Time in units of milliseconds user needs to read data allowed to wait in receive queue
+ *
+ *                  Receive queue limit of every connection is set to amount of data
+ *                  user reads in this time, but not less than one `+IPD` buffer
+ *
+ * \note            Used with \ref ESP_CFG_CONN_MANUAL_TCP_RECEIVE only
+ */
+#ifndef CONN_SELECT_RX_LATENCY
+#define CONN_SELECT_RX_LATENCY          100
+#endif
+
+/**
+ * \brief           Connection handle, which stays unique when connection number is reused
+ *
+ *                  Handle consists of connection number in lower `8` bits
+ *                  and link generation in upper bits
+ */
+typedef uint32_t conn_select_handle_t;
+
+/**
+ * \brief           Invalid connection handle
+ */
+#define CONN_SELECT_HANDLE_INVALID      0
+
+/**
+ * \brief           Get connection number from connection handle
+ * \param[in]       h: Connection handle
+ */
+#define CONN_SELECT_HANDLE_NUM(h)       ((size_t)((h) & 0xFF))
+
+/**
+ * \brief           State of single connection link
+ */
+typedef struct {
+    esp_conn_p conn;                            /*!< Connection handle or `NULL` when link is not used */
+    pbuf_chain_t rx;                            /*!< Received data not yet read by user */
+    uint8_t flags;                              /*!< Pending readiness flags */
+    uint8_t queued;                             /*!< Set to `1` when link is waiting in ready message box */
+    uint16_t gen;                               /*!< Generation, incremented every time link gets new connection */
+    uint8_t closing;                            /*!< Set to `1` when user closed connection and device did not confirm it yet */
+#if ESP_CFG_CONN_MANUAL_TCP_RECEIVE || __DOXYGEN__
+    esp_pbuf_p unacked;                         /*!< Received pbuf not confirmed to stack yet, device holds next data until confirmed */
+    uint32_t rx_time;                           /*!< Time when receive queue became non-empty */
+    size_t drain_rate;                          /*!< Average rate user reads data at, in units of bytes per second */
+#endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE || __DOXYGEN__ */
+    uint8_t accept_pending;                     /*!< Set to `1` when server connection is active but not taken by user yet */
+    uint32_t accept_time;                       /*!< Time when server connection became active */
+    conn_stats_t stats;                         /*!< Connection statistics */
+} conn_select_link_t;
+
+/**
+ * \brief           Accept statistics of selector
+ */
+typedef struct {
+    uint32_t accepted;                          /*!< Number of server connections taken by user */
+    uint32_t dropped;                           /*!< Number of server connections closed because backlog was full */
+    uint32_t wait_total;                        /*!< Sum of times from connection active to taken by user, in units of milliseconds */
+    uint32_t wait_max;                          /*!< Maximal time from connection active to taken by user, in units of milliseconds */
+} conn_select_accept_stats_t;
+
+/**
+ * \brief           Selector for multiple connections in single thread
+ */
+typedef struct {
+    esp_sys_mbox_t ready;                       /*!< Message box of links with pending readiness flags */
+    conn_select_link_t links[ESP_CFG_MAX_CONNS];/*!< Connection links, indexed by connection number */
+    conn_select_link_t notify;                  /*!< Link without connection, reports failed connection attempts */
+    size_t backlog;                             /*!< Maximal number of server connections waiting to be taken by user */
+    size_t accept_pending_cnt;                  /*!< Number of server connections waiting to be taken by user */
+    conn_select_accept_stats_t accept_stats;    /*!< Accept statistics */
+} conn_select_t;
+
+/**
+ * \brief           Client connection request
+ * \note            Request must stay valid until connection is active or has failed
+ */
+typedef struct {
+    conn_select_t* sel;                         /*!< Selector connection will be added to */
+    conn_select_handle_t h;                     /*!< Connection handle once active */
+    espr_t res;                                 /*!< \ref espINPROG while connecting, result of connection attempt afterwards */
+} conn_select_connect_t;
+
+espr_t      conn_select_init(conn_select_t* sel);
+void        conn_select_deinit(conn_select_t* sel);
+espr_t      conn_select_listen(conn_select_t* sel, esp_port_t port, uint16_t max_conn);
+void        conn_select_set_backlog(conn_select_t* sel, size_t backlog);
+size_t      conn_select_accept_many(conn_select_t* sel, conn_select_handle_t* hs, size_t max);
+void        conn_select_get_accept_stats(conn_select_t* sel, conn_select_accept_stats_t* stats);
+espr_t      conn_select_connect(conn_select_t* sel, conn_select_connect_t* req, esp_conn_type_t type, const char* host, esp_port_t port);
+espr_t      conn_select_wait(conn_select_t* sel, conn_select_handle_t* h, uint8_t* flags, uint32_t timeout);
+esp_pbuf_p  conn_select_receive(conn_select_t* sel, conn_select_handle_t h);
+espr_t      conn_select_send(conn_select_t* sel, conn_select_handle_t h, const void* data, size_t btw);
+espr_t      conn_select_send_retry(conn_select_t* sel, conn_select_handle_t h, const void* data, size_t btw);
+espr_t      conn_select_close(conn_select_t* sel, conn_select_handle_t h);
+uint8_t     conn_select_stats_next(conn_select_t* sel, size_t* index, conn_select_handle_t* h, conn_stats_t* stats);
+void        conn_select_stats_dump(conn_select_t* sel);
+conn_select_handle_t conn_select_get_handle(conn_select_t* sel, esp_conn_p conn);
+esp_conn_p  conn_select_get_conn(conn_select_t* sel, conn_select_handle_t h);
+
+void        conn_select_server_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __CONN_SELECT_BENCH_H
+#define __CONN_SELECT_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Host running TCP echo server
+ */
+#ifndef CONN_SELECT_BENCH_HOST
+#define CONN_SELECT_BENCH_HOST          "192.168.0.100"
+#endif
+
+/**
+ * \brief           Port of TCP echo server
+ */
+#ifndef CONN_SELECT_BENCH_PORT
+#define CONN_SELECT_BENCH_PORT          7
+#endif
+
+/**
+ * \brief           Number of bytes sent in every send operation
+ */
+#ifndef CONN_SELECT_BENCH_BLOCK_LEN
+#define CONN_SELECT_BENCH_BLOCK_LEN     1024
+#endif
+
+/**
+ * \brief           Benchmark duration in units of milliseconds
+ */
+#ifndef CONN_SELECT_BENCH_DURATION
+#define CONN_SELECT_BENCH_DURATION      10000
+#endif
+
+void        conn_select_bench_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef __CONN_STATS_H
+#define __CONN_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Number of `+IPD` chunk size histogram buckets
+ *
+ *                  Bucket `i` counts chunks up to `64 << i` bytes, last bucket counts all larger chunks
+ */
+#define CONN_STATS_IPD_BUCKETS          6
+
+/**
+ * \brief           Maximal number of send operations in progress with measured latency
+ */
+#ifndef CONN_STATS_SEND_FIFO
+#define CONN_STATS_SEND_FIFO            4
+#endif
+
+/**
+ * \brief           Statistics of single connection
+ */
+typedef struct {
+    size_t bytes_in;                            /*!< Number of received bytes */
+    size_t bytes_out;                           /*!< Number of bytes confirmed sent by device */
+    size_t queued;                              /*!< Number of received bytes not read by user, set on snapshot */
+    uint32_t ipd_cnt;                           /*!< Number of received `+IPD` chunks */
+    uint32_t ipd_hist[CONN_STATS_IPD_BUCKETS];  /*!< Histogram of `+IPD` chunk sizes */
+    uint32_t frames;                            /*!< Number of `AT+CIPSEND` frames needed for sent data */
+    uint32_t sends;                             /*!< Number of started send operations */
+    uint32_t sends_ok;                          /*!< Number of send operations finished with `SEND OK` */
+    uint32_t sends_pending;                     /*!< Number of send operations in progress */
+    uint32_t send_times[CONN_STATS_SEND_FIFO];  /*!< Start times of oldest send operations in progress */
+    uint8_t send_times_head;                    /*!< Index of oldest entry in start times FIFO */
+    uint8_t send_times_cnt;                     /*!< Number of entries in start times FIFO */
+    uint32_t sends_timed;                       /*!< Number of finished send operations with measured latency */
+    uint32_t latency_total;                     /*!< Sum of send latencies in units of milliseconds */
+    uint32_t latency_max;                       /*!< Maximal send latency in units of milliseconds */
+    uint32_t errors;                            /*!< Number of failed send operations */
+    uint32_t retries;                           /*!< Number of send operations marked as retry by caller */
+} conn_stats_t;
+
+void        conn_stats_reset(conn_stats_t* st);
+void        conn_stats_recv(conn_stats_t* st, size_t len);
+void        conn_stats_send_start(conn_stats_t* st, size_t len, uint8_t retry);
+void        conn_stats_send_cancel(conn_stats_t* st, size_t len, uint8_t retry);
+void        conn_stats_send_done(conn_stats_t* st, espr_t res, size_t len);
+uint32_t    conn_stats_get_latency_avg(const conn_stats_t* st);
+void        conn_stats_print(int8_t num, const conn_stats_t* st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
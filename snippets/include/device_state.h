@@ -0,0 +1,43 @@
+#ifndef __DEVICE_STATE_H
+#define __DEVICE_STATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Number of lock-free read attempts in \ref device_state_get
+ *                  before it waits for writer with system protection
+ */
+#ifndef DEVICE_STATE_READ_RETRIES
+#define DEVICE_STATE_READ_RETRIES       8
+#endif
+
+/**
+ * \brief           Cached device state
+ */
+typedef struct {
+    uint8_t joined;                             /*!< Set to `1` when station is connected to access point */
+    uint8_t has_ip;                             /*!< Set to `1` when station has IP address */
+    esp_ip_t ip;                                /*!< Station IP address, valid when `has_ip` is set */
+    esp_ip_t gw;                                /*!< Station gateway address, valid when `has_ip` is set */
+    esp_ip_t nm;                                /*!< Station netmask, valid when `has_ip` is set */
+#if ESP_CFG_MODE_ACCESS_POINT || __DOXYGEN__
+    uint8_t ap_sta_cnt;                         /*!< Number of stations connected to ESP access point */
+#endif /* ESP_CFG_MODE_ACCESS_POINT || __DOXYGEN__ */
+} device_state_t;
+
+espr_t      device_state_init(void);
+uint32_t    device_state_get(device_state_t* st);
+uint32_t    device_state_version(void);
+uint8_t     device_state_is_joined(void);
+uint8_t     device_state_has_ip(void);
+uint8_t     device_state_copy_ip(esp_ip_t* ip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
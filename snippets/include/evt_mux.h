@@ -0,0 +1,75 @@
+#ifndef __EVT_MUX_H
+#define __EVT_MUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Maximal number of listeners
+ * \note            Value must not be greater than `16`
+ */
+#ifndef EVT_MUX_MAX_LISTENERS
+#define EVT_MUX_MAX_LISTENERS           8
+#endif
+
+/**
+ * \brief           Number of event types with precomputed listener lists
+ *
+ *                  Events with larger type value are delivered only to listeners registered with \ref EVT_MUX_MASK_ALL
+ */
+#define EVT_MUX_TYPES                   64
+
+/**
+ * \brief           Maximal number of events waiting for deferred listeners
+ */
+#ifndef EVT_MUX_QUEUE_LEN
+#define EVT_MUX_QUEUE_LEN               16
+#endif
+
+/**
+ * \brief           Event type mask
+ */
+typedef uint64_t evt_mux_mask_t;
+
+/**
+ * \brief           Get mask for single event type
+ * \param[in]       type: Member of \ref esp_evt_type_t enumeration
+ */
+#define EVT_MUX_MASK(type)              ((evt_mux_mask_t)1 << (type))
+
+/**
+ * \brief           Mask for all event types
+ */
+#define EVT_MUX_MASK_ALL                (~(evt_mux_mask_t)0)
+
+/**
+ * \brief           Deferred dispatch statistics
+ */
+typedef struct {
+    uint32_t queued;                            /*!< Number of events put to queue */
+    uint32_t dropped;                           /*!< Number of events dropped because queue was full */
+    uint32_t dispatched;                        /*!< Number of events dispatched from worker thread */
+    uint32_t depth;                             /*!< Current number of events in queue */
+    uint32_t depth_max;                         /*!< Maximal number of events in queue */
+    uint32_t lag_total;                         /*!< Sum of times from event to deferred dispatch in units of milliseconds */
+    uint32_t lag_max;                           /*!< Maximal time from event to deferred dispatch in units of milliseconds */
+} evt_mux_stats_t;
+
+espr_t      evt_mux_register(esp_evt_fn fn, evt_mux_mask_t mask);
+espr_t      evt_mux_register_deferred(esp_evt_fn fn, evt_mux_mask_t mask);
+espr_t      evt_mux_unregister(esp_evt_fn fn);
+
+size_t      evt_mux_process(uint32_t timeout);
+void        evt_mux_get_stats(evt_mux_stats_t* stats);
+
+void        evt_mux_thread(void const* arg);
+void        evt_mux_deferred_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef __NETCONN_CLIENT_POOL_H
+#define __NETCONN_CLIENT_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Maximal number of pooled connections, active and idle
+ */
+#ifndef NETCONN_CLIENT_POOL_SIZE
+#define NETCONN_CLIENT_POOL_SIZE        3
+#endif
+
+/**
+ * \brief           Maximal length of host name including string termination
+ */
+#ifndef NETCONN_CLIENT_POOL_HOST_LEN
+#define NETCONN_CLIENT_POOL_HOST_LEN    32
+#endif
+
+/**
+ * \brief           Time in units of milliseconds after which idle connection is not reused anymore
+ */
+#ifndef NETCONN_CLIENT_POOL_IDLE_TIMEOUT
+#define NETCONN_CLIENT_POOL_IDLE_TIMEOUT    30000
+#endif
+
+/**
+ * \brief           Pooled connection
+ */
+typedef struct {
+    esp_netconn_p nc;                           /*!< Netconn handle or `NULL` when entry is not used */
+    char host[NETCONN_CLIENT_POOL_HOST_LEN];    /*!< Remote host name */
+    esp_port_t port;                            /*!< Remote port */
+    uint32_t last_used;                         /*!< Time when connection was returned to pool */
+    uint8_t in_use;                             /*!< Set to `1` while connection is checked out */
+} netconn_client_pool_entry_t;
+
+/**
+ * \brief           Pool of client connections, keyed by host and port
+ */
+typedef struct {
+    esp_sys_mutex_t mutex;                      /*!< Mutex protecting entries */
+    netconn_client_pool_entry_t entries[NETCONN_CLIENT_POOL_SIZE];  /*!< Pooled connections */
+    uint32_t hits;                              /*!< Number of checkouts served with idle connection */
+    uint32_t misses;                            /*!< Number of checkouts which created new connection */
+    uint32_t evictions;                         /*!< Number of idle connections closed to make space */
+} netconn_client_pool_t;
+
+espr_t      netconn_client_pool_init(netconn_client_pool_t* pool);
+void        netconn_client_pool_deinit(netconn_client_pool_t* pool);
+espr_t      netconn_client_pool_get(netconn_client_pool_t* pool, const char* host, esp_port_t port, esp_netconn_p* nc);
+void        netconn_client_pool_put(netconn_client_pool_t* pool, esp_netconn_p nc, uint8_t reusable);
+
+void        netconn_client_pool_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
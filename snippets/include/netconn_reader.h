@@ -0,0 +1,32 @@
+#ifndef __NETCONN_READER_H
+#define __NETCONN_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+#include "pbuf_cursor.h"
+
+/**
+ * \brief           Socket-like reader on top of netconn receive queue
+ *
+ *                  Reader keeps last received pbuf and cursor at first unread byte,
+ *                  so that data not copied to user buffer are returned on next read
+ */
+typedef struct {
+    esp_netconn_p nc;                           /*!< Netconn to read from */
+    esp_pbuf_p p;                               /*!< Received pbuf with unread data or `NULL` */
+    pbuf_cursor_t c;                            /*!< Cursor at first unread byte in pbuf */
+} netconn_reader_t;
+
+void        netconn_reader_init(netconn_reader_t* r, esp_netconn_p nc);
+espr_t      netconn_reader_read(netconn_reader_t* r, void* data, size_t len, size_t* br);
+size_t      netconn_reader_pending(const netconn_reader_t* r);
+void        netconn_reader_free(netconn_reader_t* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
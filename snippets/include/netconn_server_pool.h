@@ -0,0 +1,62 @@
+#ifndef __NETCONN_SERVER_POOL_H
+#define __NETCONN_SERVER_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Client processing function, called from worker thread
+ * \note            Client netconn is closed, if still active, and deleted by pool after function returns
+ * \param[in]       client: Accepted client netconn
+ * \param[in]       arg: User argument
+ */
+typedef void (*netconn_server_pool_fn)(esp_netconn_p client, void* arg);
+
+/**
+ * \brief           Accepted client waiting in work queue
+ */
+typedef struct {
+    esp_netconn_p client;                       /*!< Client netconn, `NULL` when job slot is free */
+    uint32_t time;                              /*!< Time when client was accepted */
+} netconn_server_pool_job_t;
+
+/**
+ * \brief           Server pool statistics
+ */
+typedef struct {
+    uint32_t accepted;                          /*!< Number of clients put to work queue */
+    uint32_t rejected;                          /*!< Number of clients closed because work queue was full */
+    uint32_t served;                            /*!< Number of clients processed by workers */
+    uint32_t wait_total;                        /*!< Sum of queue wait times in units of milliseconds */
+    uint32_t wait_max;                          /*!< Maximal queue wait time in units of milliseconds */
+} netconn_server_pool_stats_t;
+
+/**
+ * \brief           Netconn server with fixed number of worker threads
+ */
+typedef struct {
+    esp_netconn_p server;                       /*!< Listening netconn */
+    esp_sys_mbox_t queue;                       /*!< Work queue of accepted clients */
+    esp_sys_sem_t done;                         /*!< Released by last worker on exit */
+    size_t workers_running;                     /*!< Number of started workers which did not exit yet */
+    netconn_server_pool_job_t* jobs;            /*!< Job slots referenced from work queue */
+    size_t jobs_len;                            /*!< Number of job slots */
+    size_t jobs_w;                              /*!< Next job slot to check when searching for free one */
+    size_t jobs_used;                           /*!< Number of job slots in queue or not yet copied by worker */
+    netconn_server_pool_fn fn;                  /*!< Client processing function */
+    void* arg;                                  /*!< User argument for processing function */
+    netconn_server_pool_stats_t stats;          /*!< Pool statistics */
+} netconn_server_pool_t;
+
+espr_t      netconn_server_pool_run(netconn_server_pool_t* pool, esp_port_t port, size_t workers, size_t queue_len,
+                                    size_t stack_size, netconn_server_pool_fn fn, void* arg);
+void        netconn_server_pool_get_stats(netconn_server_pool_t* pool, netconn_server_pool_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
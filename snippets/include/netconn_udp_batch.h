@@ -0,0 +1,46 @@
+#ifndef __NETCONN_UDP_BATCH_H
+#define __NETCONN_UDP_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Maximal number of tries to queue blocking send while earlier datagrams are queued,
+ *                  tries are `10` ms apart
+ */
+#ifndef NETCONN_UDP_BATCH_SEND_RETRIES
+#define NETCONN_UDP_BATCH_SEND_RETRIES  100
+#endif
+
+/**
+ * \brief           Datagram to send
+ */
+typedef struct {
+    esp_ip_t ip;                                /*!< Destination IP address */
+    esp_port_t port;                            /*!< Destination port */
+    const void* data;                           /*!< Datagram data */
+    size_t len;                                 /*!< Datagram length in units of bytes */
+} netconn_udp_tx_t;
+
+/**
+ * \brief           Received datagram
+ */
+typedef struct {
+    esp_ip_t ip;                                /*!< Remote IP address of netconn connection */
+    esp_port_t port;                            /*!< Remote port of netconn connection */
+    esp_pbuf_p p;                               /*!< Datagram data, must be freed by user */
+} netconn_udp_rx_t;
+
+espr_t      netconn_udp_sendto_batch(esp_netconn_p nc, const netconn_udp_tx_t* d, size_t cnt, size_t* sent);
+size_t      netconn_udp_recvfrom_batch(esp_netconn_p nc, netconn_udp_rx_t* d, size_t cnt, espr_t* res);
+
+void        netconn_udp_batch_thread(void const* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __PBUF_CHAIN_H
+#define __PBUF_CHAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Number of pending pbufs stored in chain head before array is moved to heap
+ */
+#ifndef PBUF_CHAIN_SEGS
+#define PBUF_CHAIN_SEGS                 16
+#endif
+
+/**
+ * \brief           Chain head structure for appending pbufs without walking the chain
+ */
+typedef struct {
+    esp_pbuf_p head;                            /*!< First pbuf in linked chain */
+    esp_pbuf_p segs_buf[PBUF_CHAIN_SEGS];       /*!< Inline storage for pending pbufs, not linked to chain yet */
+    esp_pbuf_p* segs;                           /*!< Heap array of pending pbufs or `NULL` when inline storage is used */
+    size_t segs_size;                           /*!< Number of entries in heap array */
+    size_t segs_cnt;                            /*!< Number of pending pbufs */
+    size_t tot_len;                             /*!< Total length of all pbufs in units of bytes */
+    size_t cnt;                                 /*!< Number of appended pbufs */
+} pbuf_chain_t;
+
+void        pbuf_chain_init(pbuf_chain_t* ch);
+void        pbuf_chain_append(pbuf_chain_t* ch, esp_pbuf_p p);
+void        pbuf_chain_append_ref(pbuf_chain_t* ch, esp_pbuf_p p);
+esp_pbuf_p  pbuf_chain_get(pbuf_chain_t* ch);
+esp_pbuf_p  pbuf_chain_take(pbuf_chain_t* ch);
+size_t      pbuf_chain_length(const pbuf_chain_t* ch);
+size_t      pbuf_chain_count(const pbuf_chain_t* ch);
+void        pbuf_chain_free(pbuf_chain_t* ch);
+
+void        pbuf_chain_benchmark(size_t count, size_t seg_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __PBUF_CURSOR_H
+#define __PBUF_CURSOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Sequential reader over pbuf chain
+ *
+ *                  Cursor remembers pbuf in a chain and offset inside it,
+ *                  so that moving forward never restarts from chain head
+ */
+typedef struct {
+    esp_pbuf_p p;                               /*!< Current pbuf in a chain or `NULL` when cursor is at the end */
+    size_t off;                                 /*!< Offset inside current pbuf */
+    size_t pos;                                 /*!< Absolute position from beginning of chain */
+    size_t rem;                                 /*!< Number of bytes cursor may still read */
+} pbuf_cursor_t;
+
+void        pbuf_cursor_init(pbuf_cursor_t* c, esp_pbuf_p p, size_t offset);
+void        pbuf_cursor_init_range(pbuf_cursor_t* c, esp_pbuf_p p, size_t offset, size_t len);
+size_t      pbuf_cursor_pos(const pbuf_cursor_t* c);
+uint8_t     pbuf_cursor_eof(const pbuf_cursor_t* c);
+uint8_t     pbuf_cursor_peek(const pbuf_cursor_t* c, uint8_t* el);
+uint8_t     pbuf_cursor_next(pbuf_cursor_t* c, uint8_t* el);
+size_t      pbuf_cursor_skip(pbuf_cursor_t* c, size_t len);
+size_t      pbuf_cursor_read(pbuf_cursor_t* c, void* data, size_t len);
+size_t      pbuf_cursor_read_until(pbuf_cursor_t* c, uint8_t delim, void* data, size_t len, uint8_t* found);
+const void* pbuf_cursor_span(pbuf_cursor_t* c, size_t* len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __PBUF_SLICE_H
+#define __PBUF_SLICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+#include "pbuf_cursor.h"
+
+/**
+ * \brief           Zero-copy view to range of bytes in pbuf chain
+ *
+ *                  Slice holds reference on first pbuf in a chain which contains its data,
+ *                  therefore data stay valid even after original owner frees the chain
+ */
+typedef struct {
+    esp_pbuf_p p;                               /*!< Referenced pbuf where slice data start */
+    size_t off;                                 /*!< Offset of slice data in referenced pbuf */
+    size_t len;                                 /*!< Length of slice in units of bytes */
+} pbuf_slice_t;
+
+/**
+ * \brief           Pointer to \ref pbuf_slice_t structure
+ */
+typedef pbuf_slice_t* pbuf_slice_p;
+
+espr_t      pbuf_slice_init(pbuf_slice_p s, esp_pbuf_p p, size_t offset, size_t len);
+espr_t      pbuf_slice_sub(pbuf_slice_p s, const pbuf_slice_p from, size_t offset, size_t len);
+void        pbuf_slice_free(pbuf_slice_p s);
+
+pbuf_slice_p    pbuf_slice_new(esp_pbuf_p p, size_t offset, size_t len);
+void            pbuf_slice_delete(pbuf_slice_p s);
+
+size_t      pbuf_slice_length(const pbuf_slice_p s);
+size_t      pbuf_slice_copy(const pbuf_slice_p s, void* data, size_t len, size_t offset);
+const void* pbuf_slice_get_linear_addr(const pbuf_slice_p s, size_t offset, size_t* new_len);
+void        pbuf_slice_cursor(const pbuf_slice_p s, pbuf_cursor_t* c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
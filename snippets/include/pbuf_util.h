@@ -0,0 +1,27 @@
+#ifndef __PBUF_UTIL_H
+#define __PBUF_UTIL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Initial value for \ref pbuf_util_fnv1a on first call
+ */
+#define PBUF_UTIL_FNV1A_INIT            ((uint32_t)0x811C9DC5)
+
+int         pbuf_util_memcmp(const esp_pbuf_p p, size_t offset, const void* data, size_t len);
+size_t      pbuf_util_memchr(const esp_pbuf_p p, size_t offset, size_t len, uint8_t ch);
+uint32_t    pbuf_util_crc32(const esp_pbuf_p p, size_t offset, size_t len, uint32_t crc);
+uint32_t    pbuf_util_fnv1a(const esp_pbuf_p p, size_t offset, size_t len, uint32_t hash);
+
+size_t      pbuf_util_overhead(size_t len);
+void        pbuf_util_overhead_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
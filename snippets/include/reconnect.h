@@ -0,0 +1,39 @@
+#ifndef __RECONNECT_H
+#define __RECONNECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Callback function called after successful connection
+ * \param[in]       arg: User argument
+ */
+typedef void (*reconnect_fn)(void* arg);
+
+/**
+ * \brief           Reconnect policy with exponential backoff and jitter
+ */
+typedef struct {
+    uint32_t base;                              /*!< Delay after first failed attempt in units of milliseconds */
+    uint32_t max;                               /*!< Maximal delay in units of milliseconds */
+    uint32_t attempts;                          /*!< Number of failed attempts since last successful connection */
+    uint32_t rand;                              /*!< Random generator state */
+    reconnect_fn connected_fn;                  /*!< Optional callback after successful connection */
+    void* connected_arg;                        /*!< User argument for callback */
+} reconnect_t;
+
+void        reconnect_init(reconnect_t* rc, uint32_t base, uint32_t max, uint32_t seed);
+void        reconnect_set_connected_fn(reconnect_t* rc, reconnect_fn fn, void* arg);
+uint32_t    reconnect_next_delay(reconnect_t* rc);
+void        reconnect_wait(reconnect_t* rc);
+void        reconnect_success(reconnect_t* rc);
+espr_t      reconnect_netconn_connect(reconnect_t* rc, esp_netconn_p nc, const char* host, esp_port_t port, uint32_t max_attempts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __TIMER_WHEEL_H
+#define __TIMER_WHEEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \brief           Number of wheel slots
+ */
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS               32
+#endif
+
+/**
+ * \brief           Duration of single slot in units of milliseconds
+ */
+#ifndef TIMER_WHEEL_TICK
+#define TIMER_WHEEL_TICK                10
+#endif
+
+/**
+ * \brief           Timer callback function, called from ESP processing thread
+ * \param[in]       arg: User argument
+ */
+typedef void (*timer_wheel_fn)(void* arg);
+
+/**
+ * \brief           Timer, memory is provided by user
+ */
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer* next;             /*!< Next timer in slot or in expired list */
+    struct timer_wheel_timer* prev;             /*!< Previous timer in slot or in expired list */
+    timer_wheel_fn fn;                          /*!< Callback function */
+    void* arg;                                  /*!< User argument */
+    uint32_t deadline;                          /*!< Absolute time when timer expires */
+    uint16_t slot;                              /*!< Slot timer is linked to */
+    uint8_t active;                             /*!< Set to `1` while timer is armed */
+    uint8_t expired;                            /*!< Set to `1` while expired timer waits for its callback */
+} timer_wheel_timer_t;
+
+espr_t      timer_wheel_add(timer_wheel_timer_t* t, uint32_t time, timer_wheel_fn fn, void* arg);
+void        timer_wheel_remove(timer_wheel_timer_t* t);
+uint8_t     timer_wheel_is_active(const timer_wheel_timer_t* t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
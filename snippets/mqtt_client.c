@@ -12,8 +12,10 @@
 
 #include "esp/apps/esp_mqtt_client.h"
 #include "esp/esp.h"
-#include "esp/esp_timeout.h"
 #include "mqtt_client.h"
+#include "timer_wheel.h"
+#include "reconnect.h"
+#include "evt_mux.h"
 
 /**
  * \brief           MQTT client structure
@@ -39,8 +41,27 @@ mqtt_client_info = {
     // .pass = "test_password",
 };
 
+/**
+ * \brief           Timer for periodic publishing
+ */
+static timer_wheel_timer_t
+mqtt_timer;
+
+/**
+ * \brief           Timer for delayed reconnection
+ */
+static timer_wheel_timer_t
+mqtt_reconnect_timer;
+
+/**
+ * \brief           Reconnect policy
+ */
+static reconnect_t
+mqtt_reconnect;
+
 static void mqtt_cb(esp_mqtt_client_p client, esp_mqtt_evt_t* evt);
 static void example_do_connect(esp_mqtt_client_p client);
+static void example_schedule_connect(esp_mqtt_client_p client);
 static uint32_t retries = 0;
 
 /**
@@ -68,7 +89,7 @@ void
 mqtt_client_thread(void const* arg) {
     esp_mac_t mac;
 
-    esp_evt_register(mqtt_esp_cb);              /* Register new callback for general events from ESP stack */
+    evt_mux_register(mqtt_esp_cb, EVT_MUX_MASK(ESP_EVT_WIFI_GOT_IP));  /* Register new callback for IP events from ESP stack */
     
     /* Get station MAC to format client ID */
     if (esp_sta_getmac(&mac, 0, NULL, NULL, 1) == espOK) {
@@ -80,6 +101,7 @@ mqtt_client_thread(void const* arg) {
         strcpy(mqtt_client_id, "unknown");
     }
     printf("MQTT Client ID: %s\r\n", mqtt_client_id);
+    reconnect_init(&mqtt_reconnect, 1000, 60000, 0);   /* Retry after 1 to 60 seconds */
 
     /*
      * Create a new client with 256 bytes of RAW TX data
@@ -117,7 +139,7 @@ mqtt_timeout_cb(void* arg) {
             printf("Cannot publish...: %d\r\n", (int)res);
         }
     }
-    esp_timeout_add(10000, mqtt_timeout_cb, client);
+    timer_wheel_add(&mqtt_timer, 10000, mqtt_timeout_cb, client);
 }
 
 /**
@@ -138,6 +160,7 @@ mqtt_cb(esp_mqtt_client_p client, esp_mqtt_evt_t* evt) {
             
             if (status == ESP_MQTT_CONN_STATUS_ACCEPTED) {
                 printf("MQTT accepted!\r\n");
+                reconnect_success(&mqtt_reconnect);
                 /*
                  * Once we are accepted by server, 
                  * it is time to subscribe to different topics
@@ -147,12 +170,12 @@ mqtt_cb(esp_mqtt_client_p client, esp_mqtt_evt_t* evt) {
                 esp_mqtt_client_subscribe(client, "esp8266_mqtt_topic", ESP_MQTT_QOS_EXACTLY_ONCE, "esp8266_mqtt_topic");
                 
                 /* Start timeout timer after 5000ms and call mqtt_timeout_cb function */
-                esp_timeout_add(5000, mqtt_timeout_cb, client);
+                timer_wheel_add(&mqtt_timer, 5000, mqtt_timeout_cb, client);
             } else {
                 printf("MQTT server connection was not successful: %d\r\n", (int)status);
                 
-                /* Try to connect all over again */
-                example_do_connect(client);
+                /* Try to connect all over again, after backoff delay */
+                example_schedule_connect(client);
             }
             break;
         }
@@ -208,7 +231,7 @@ mqtt_cb(esp_mqtt_client_p client, esp_mqtt_evt_t* evt) {
         /* Client is fully disconnected from MQTT server */
         case ESP_MQTT_EVT_DISCONNECT: {
             printf("MQTT client disconnected!\r\n");
-            example_do_connect(client);         /* Connect to server all over again */
+            example_schedule_connect(client);   /* Connect to server all over again, after backoff delay */
             break;
         }
         
@@ -229,6 +252,28 @@ example_do_connect(esp_mqtt_client_p client) {
      * MQTT server on mosquitto.org
      */
     retries++;
-    esp_timeout_remove(mqtt_timeout_cb);
+    timer_wheel_remove(&mqtt_timer);
+    timer_wheel_remove(&mqtt_reconnect_timer);
     esp_mqtt_client_connect(mqtt_client, "test.mosquitto.org", 1883, mqtt_cb, &mqtt_client_info);
 }
+
+/**
+ * \brief           Timer callback for delayed reconnection
+ * \param[in]       arg: MQTT client handle
+ */
+static void
+example_reconnect_cb(void* arg) {
+    example_do_connect(arg);
+}
+
+/**
+ * \brief           Connect to MQTT server after backoff delay
+ * \param[in]       client: MQTT client handle
+ */
+static void
+example_schedule_connect(esp_mqtt_client_p client) {
+    uint32_t delay = reconnect_next_delay(&mqtt_reconnect);
+
+    printf("MQTT reconnecting in %d ms\r\n", (int)delay);
+    timer_wheel_add(&mqtt_reconnect_timer, delay, example_reconnect_cb, client);
+}
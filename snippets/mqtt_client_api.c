@@ -12,6 +12,7 @@
 
 #include "esp/apps/esp_mqtt_client_api.h"
 #include "mqtt_client_api.h"
+#include "reconnect.h"
 #include "esp/esp_mem.h"
 
 /**
@@ -32,6 +33,21 @@ mqtt_client_info = {
     // .pass = "test_password",
 };
 
+/**
+ * \brief           Subscribe to topics after every successful connection
+ * \param[in]       arg: MQTT client handle
+ */
+static void
+mqtt_client_api_subscribe_topics(void* arg) {
+    esp_mqtt_client_api_p client = arg;
+
+    if (esp_mqtt_client_api_subscribe(client, "esp8266_mqtt_topic", ESP_MQTT_QOS_AT_LEAST_ONCE) == espOK) {
+        printf("Subscribed to esp8266_mqtt_topic\r\n");
+    } else {
+        printf("Problem subscribing to topic!\r\n");
+    }
+}
+
 /**
  * \brief           MQTT client API thread
  */
@@ -40,6 +56,7 @@ mqtt_client_api_thread(void const* arg) {
     esp_mqtt_client_api_p client;
     esp_mqtt_conn_status_t conn_status;
     esp_mqtt_client_api_buf_p buf;
+    reconnect_t rc;
     espr_t res;
 
     /* Create new MQTT API */
@@ -48,6 +65,10 @@ mqtt_client_api_thread(void const* arg) {
         goto terminate;
     }
 
+    /* Retry after 1 to 60 seconds, subscribe again on every connection */
+    reconnect_init(&rc, 1000, 60000, 0);
+    reconnect_set_connected_fn(&rc, mqtt_client_api_subscribe_topics, client);
+
     while (1) {
         /* Make a connection */
         printf("Joining MQTT server\r\n");
@@ -59,16 +80,10 @@ mqtt_client_api_thread(void const* arg) {
             printf("Client is ready to subscribe and publish to new messages\r\n");
         } else {
             printf("Connect API response: %d\r\n", (int)conn_status);
-            esp_delay(5000);
+            reconnect_wait(&rc);
             continue;
         }
-
-        /* Subscribe to topics */
-        if (esp_mqtt_client_api_subscribe(client, "esp8266_mqtt_topic", ESP_MQTT_QOS_AT_LEAST_ONCE) == espOK) {
-            printf("Subscribed to esp8266_mqtt_topic\r\n");
-        } else {
-            printf("Problem subscribing to topic!\r\n");
-        }
+        reconnect_success(&rc);                 /* Subscribes to topics */
 
         while (1) {
             /* Receive MQTT packet with 1000ms timeout */
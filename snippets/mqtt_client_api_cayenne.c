@@ -8,6 +8,8 @@
 
 #include "esp/apps/esp_mqtt_client_api.h"
 #include "mqtt_client_api.h"
+#include "reconnect.h"
+#include "device_state.h"
 
 /* Override safeprintf function */
 #define safeprintf          printf
@@ -32,6 +34,22 @@ mqtt_client_str[256];
 static char
 mqtt_client_data[256];
 
+/**
+ * \brief           Subscribe to command topics after every successful connection
+ * \param[in]       arg: MQTT client handle
+ */
+static void
+mqtt_client_api_cayenne_subscribe(void* arg) {
+    esp_mqtt_client_api_p client = arg;
+
+    sprintf(mqtt_client_str, "v1/%s/things/%s/cmd/#", mqtt_client_info.user, mqtt_client_info.id);
+    if (esp_mqtt_client_api_subscribe(client, mqtt_client_str, ESP_MQTT_QOS_AT_LEAST_ONCE) == espOK) {
+        safeprintf("[MQTT] Subscribed to topic: %s\r\n", mqtt_client_str);
+    } else {
+        safeprintf("[MQTT] Problem subscribing to topic!\r\n");
+    }
+}
+
 /**
  * \brief           MQTT thread
  */
@@ -40,31 +58,29 @@ mqtt_client_api_cayenne_thread(void const* arg) {
     esp_mqtt_client_api_p client = NULL;
     esp_mqtt_conn_status_t status;
     esp_mqtt_client_api_buf_p buf;
+    reconnect_t rc;
     espr_t res;
 
+    reconnect_init(&rc, 1000, 60000, 0);        /* Retry after 1 to 60 seconds */
+    device_state_init();                        /* Track station status from events */
+
 beg:
     while (1) {
         /* Wait IP and connected to network */
-        while (!esp_sta_has_ip()) {
+        while (!device_state_has_ip()) {        /* Cached status, no AT command */
             esp_delay(1000);
         }
 
         if (client == NULL) {
             client = esp_mqtt_client_api_new(256, 256);
+            reconnect_set_connected_fn(&rc, mqtt_client_api_cayenne_subscribe, client);
         }
         if (client != NULL) {
             safeprintf("[MQTT] Connecting to MQTT broker...\r\n");
             status = esp_mqtt_client_api_connect(client, "mqtt.mydevices.com", 1883, &mqtt_client_info);
             if (status == ESP_MQTT_CONN_STATUS_ACCEPTED) {
                 safeprintf("[MQTT] Connected to MQTT broker and ready to publish/subscribe to topics...\r\n");
-
-                /* Subscribe to topic */
-                sprintf(mqtt_client_str, "v1/%s/things/%s/cmd/#", mqtt_client_info.user, mqtt_client_info.id);
-                if (esp_mqtt_client_api_subscribe(client, mqtt_client_str, ESP_MQTT_QOS_AT_LEAST_ONCE) == espOK) {
-                    safeprintf("[MQTT] Subscribed to topic: %s\r\n", mqtt_client_str);
-                } else {
-                    safeprintf("[MQTT] Problem subscribing to topic!\r\n");
-                }
+                reconnect_success(&rc);         /* Subscribes to topic */
 
                 /* Start accepting and publishing data */
                 while (1) {
@@ -96,6 +112,7 @@ beg:
                         }
                     } else if (res == espCLOSED) {
                         safeprintf("[MQTT] Connection closed!\r\n");
+                        reconnect_wait(&rc);    /* Do not reconnect in lockstep with other devices */
                         goto beg;
                     } else if (res == espTIMEOUT) {
                         safeprintf("[MQTT] Receive timeout!\r\n");
@@ -110,7 +127,7 @@ beg:
                 printf("[MQTT] Connect error: %d\r\n", (int)status);
             }
         }
-        esp_delay(1000);
+        reconnect_wait(&rc);
     }
     if (client != NULL) {
         esp_mqtt_client_api_delete(client);
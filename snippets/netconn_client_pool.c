@@ -0,0 +1,341 @@
+/*
+ * Netconn client pool keeps connections to remote hosts open after request is finished.
+ *
+ * Next request to the same host and port takes idle connection from the pool,
+ * which skips DNS resolving, AT+CIPSTART and TCP handshake.
+ * Idle connection is validated before it is returned to user,
+ * when pool is full, least recently used idle connection is closed.
+ */
+#include <stdlib.h>
+#include <ctype.h>
+#include "netconn_client_pool.h"
+#include "pbuf_cursor.h"
+
+/**
+ * \brief           Close and delete netconn
+ * \param[in]       nc: Netconn handle
+ */
+static void
+netconn_client_pool_release(esp_netconn_p nc) {
+    if (esp_conn_is_active(esp_netconn_get_conn(nc))) {
+        esp_netconn_close(nc);
+    }
+    esp_netconn_delete(nc);
+}
+
+/**
+ * \brief           Initialize client pool
+ * \param[in]       pool: Pool handle
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+netconn_client_pool_init(netconn_client_pool_t* pool) {
+    memset(pool, 0x00, sizeof(*pool));
+    if (!esp_sys_mutex_create(&pool->mutex)) {
+        esp_sys_mutex_invalid(&pool->mutex);
+        return espERRMEM;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Close all idle connections and release pool
+ * \note            All connections must be returned to pool before calling this function
+ * \param[in]       pool: Pool handle
+ */
+void
+netconn_client_pool_deinit(netconn_client_pool_t* pool) {
+    for (size_t i = 0; i < ESP_ARRAYSIZE(pool->entries); i++) {
+        if (pool->entries[i].nc != NULL) {
+            netconn_client_pool_release(pool->entries[i].nc);
+            pool->entries[i].nc = NULL;
+        }
+    }
+    if (esp_sys_mutex_isvalid(&pool->mutex)) {
+        esp_sys_mutex_delete(&pool->mutex);
+        esp_sys_mutex_invalid(&pool->mutex);
+    }
+}
+
+/**
+ * \brief           Get connection to remote host
+ *
+ *                  Idle connection to the same host and port is reused when still active.
+ *                  Otherwise new connection is created, which blocks until connected
+ *
+ * \param[in]       pool: Pool handle
+ * \param[in]       host: Remote host name or IP address,
+ *                      shorter than \ref NETCONN_CLIENT_POOL_HOST_LEN characters
+ * \param[in]       port: Remote port
+ * \param[out]      nc: Output variable to save connected netconn to.
+ *                      Netconn must be returned with \ref netconn_client_pool_put
+ * \return          \ref espOK on success, \ref espPARERR if host name is too long,
+ *                      member of \ref espr_t otherwise
+ */
+espr_t
+netconn_client_pool_get(netconn_client_pool_t* pool, const char* host, esp_port_t port, esp_netconn_p* nc) {
+    netconn_client_pool_entry_t *e, *entry = NULL, *lru = NULL;
+    esp_netconn_p stale[NETCONN_CLIENT_POOL_SIZE];
+    size_t stale_cnt = 0;
+    uint32_t now;
+    espr_t res;
+
+    *nc = NULL;
+    if (strlen(host) >= NETCONN_CLIENT_POOL_HOST_LEN) {
+        return espPARERR;                       /* Could not be matched with saved host name */
+    }
+    esp_sys_mutex_lock(&pool->mutex);
+    now = esp_sys_now();
+    for (size_t i = 0; i < ESP_ARRAYSIZE(pool->entries); i++) {
+        e = &pool->entries[i];
+        if (e->nc == NULL || e->in_use) {
+            continue;
+        }
+        /* Drop idle connections closed by remote side or idle for too long */
+        if (!esp_conn_is_active(esp_netconn_get_conn(e->nc))
+            || now - e->last_used > NETCONN_CLIENT_POOL_IDLE_TIMEOUT) {
+            stale[stale_cnt++] = e->nc;
+            e->nc = NULL;
+            continue;
+        }
+        if (*nc == NULL && e->port == port && !strcmp(e->host, host)) {
+            e->in_use = 1;
+            *nc = e->nc;
+        }
+    }
+    if (*nc != NULL) {
+        pool->hits++;
+    } else {
+        pool->misses++;
+    }
+    esp_sys_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < stale_cnt; i++) {
+        netconn_client_pool_release(stale[i]);
+    }
+    if (*nc != NULL) {
+        return espOK;
+    }
+
+    /* Create new connection, without holding mutex */
+    if ((*nc = esp_netconn_new(ESP_NETCONN_TYPE_TCP)) == NULL) {
+        return espERRMEM;
+    }
+    if ((res = esp_netconn_connect(*nc, host, port)) != espOK) {
+        esp_netconn_delete(*nc);
+        *nc = NULL;
+        return res;
+    }
+
+    /* Add to pool, evict least recently used idle connection if there is no free entry */
+    esp_sys_mutex_lock(&pool->mutex);
+    for (size_t i = 0; i < ESP_ARRAYSIZE(pool->entries); i++) {
+        e = &pool->entries[i];
+        if (e->nc == NULL) {
+            entry = e;
+            break;
+        }
+        if (!e->in_use && (lru == NULL || (int32_t)(e->last_used - lru->last_used) < 0)) {
+            lru = e;
+        }
+    }
+    stale_cnt = 0;
+    if (entry == NULL && lru != NULL) {
+        stale[stale_cnt++] = lru->nc;
+        pool->evictions++;
+        entry = lru;
+    }
+    if (entry != NULL) {
+        strcpy(entry->host, host);              /* Length checked on entry */
+        entry->port = port;
+        entry->nc = *nc;
+        entry->in_use = 1;
+    }
+    esp_sys_mutex_unlock(&pool->mutex);
+
+    if (stale_cnt > 0) {
+        netconn_client_pool_release(stale[0]);
+    }
+    return espOK;                               /* Connection not in pool is deleted on return */
+}
+
+/**
+ * \brief           Return connection to pool
+ * \param[in]       pool: Pool handle
+ * \param[in]       nc: Netconn handle returned by \ref netconn_client_pool_get
+ * \param[in]       reusable: Set to `1` when response has been fully read
+ *                      and connection may be used for next request, `0` to close it
+ */
+void
+netconn_client_pool_put(netconn_client_pool_t* pool, esp_netconn_p nc, uint8_t reusable) {
+    netconn_client_pool_entry_t* e = NULL;
+
+    esp_sys_mutex_lock(&pool->mutex);
+    for (size_t i = 0; i < ESP_ARRAYSIZE(pool->entries); i++) {
+        if (pool->entries[i].nc == nc) {
+            e = &pool->entries[i];
+            break;
+        }
+    }
+    if (e != NULL && reusable && esp_conn_is_active(esp_netconn_get_conn(nc))) {
+        e->in_use = 0;
+        e->last_used = esp_sys_now();
+        nc = NULL;                              /* Keep connection open */
+    } else if (e != NULL) {
+        e->nc = NULL;
+    }
+    esp_sys_mutex_unlock(&pool->mutex);
+
+    if (nc != NULL) {
+        netconn_client_pool_release(nc);
+    }
+}
+
+/**
+ * \brief           Host and port for example requests
+ */
+#define NETCONN_CLIENT_POOL_HOST        "example.com"
+#define NETCONN_CLIENT_POOL_PORT        80
+
+/**
+ * \brief           Request keeping connection open after response
+ */
+static const char
+netconn_client_pool_req[] = ""
+"GET / HTTP/1.1\r\n"
+"Host: " NETCONN_CLIENT_POOL_HOST "\r\n"
+"Connection: keep-alive\r\n"
+"\r\n";
+
+/**
+ * \brief           HTTP response parser state
+ */
+typedef struct {
+    uint8_t hdr_done;                           /*!< Set to `1` once empty line after headers is received */
+    size_t content_len;                         /*!< Value of `Content-Length` header or `ESP_SIZET_MAX` if not received */
+    size_t body_len;                            /*!< Number of received body bytes */
+    size_t line_len;                            /*!< Number of bytes in current header line */
+    char line[32];                              /*!< Beginning of current header line */
+} netconn_client_pool_http_t;
+
+/**
+ * \brief           Parse finished header line
+ * \param[in]       h: Parser state
+ */
+static void
+netconn_client_pool_http_line(netconn_client_pool_http_t* h) {
+    static const char name[] = "content-length:";
+    size_t i;
+
+    h->line[h->line_len] = 0;
+    if (h->line_len == 0) {
+        h->hdr_done = 1;                        /* Empty line, end of headers */
+        return;
+    }
+
+    /* Header names are case insensitive */
+    for (i = 0; name[i] != 0 && tolower((unsigned char)h->line[i]) == name[i]; i++) {}
+    if (name[i] == 0) {
+        h->content_len = strtoul(&h->line[i], NULL, 10);
+    }
+}
+
+/**
+ * \brief           Parse new received pbuf of HTTP response
+ *
+ *                  Every byte is processed once, no matter in how many packets response is received
+ *
+ * \param[in]       h: Parser state
+ * \param[in]       p: New received pbuf
+ */
+static void
+netconn_client_pool_http_parse(netconn_client_pool_http_t* h, esp_pbuf_p p) {
+    pbuf_cursor_t c;
+    uint8_t ch;
+
+    pbuf_cursor_init(&c, p, 0);
+    while (!h->hdr_done && pbuf_cursor_next(&c, &ch)) {
+        if (ch == '\n') {
+            netconn_client_pool_http_line(h);
+            h->line_len = 0;
+        } else if (ch != '\r' && h->line_len < sizeof(h->line) - 1) {
+            h->line[h->line_len++] = ch;
+        }
+    }
+    if (h->hdr_done) {
+        h->body_len += esp_pbuf_length(p, 1) - pbuf_cursor_pos(&c);
+    }
+}
+
+/**
+ * \brief           Send HTTP request on pooled connection and read full response
+ *
+ *                  Connection is reused only when response has `Content-Length` header,
+ *                  otherwise end of response cannot be detected without closing connection
+ *
+ * \param[in]       pool: Pool handle
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+netconn_client_pool_http_get(netconn_client_pool_t* pool) {
+    netconn_client_pool_http_t h;
+    esp_netconn_p nc;
+    esp_pbuf_p p;
+    uint8_t reusable = 0;
+    espr_t res;
+
+    if ((res = netconn_client_pool_get(pool, NETCONN_CLIENT_POOL_HOST, NETCONN_CLIENT_POOL_PORT, &nc)) != espOK) {
+        return res;
+    }
+    res = esp_netconn_write(nc, netconn_client_pool_req, sizeof(netconn_client_pool_req) - 1);
+    if (res == espOK) {
+        res = esp_netconn_flush(nc);
+    }
+
+    memset(&h, 0x00, sizeof(h));
+    h.content_len = ESP_SIZET_MAX;
+    while (res == espOK) {
+        if ((res = esp_netconn_receive(nc, &p)) != espOK) {
+            break;
+        }
+        netconn_client_pool_http_parse(&h, p);  /* Parser keeps all state it needs */
+        esp_pbuf_free(p);
+        if (!h.hdr_done) {
+            continue;                           /* Headers not complete yet */
+        }
+        if (h.content_len == ESP_SIZET_MAX) {
+            break;                              /* Cannot detect end of response */
+        }
+        if (h.body_len >= h.content_len) {
+            reusable = 1;                       /* Full response received */
+            break;
+        }
+    }
+    netconn_client_pool_put(pool, nc, reusable);
+    return res;
+}
+
+/**
+ * \brief           Send multiple requests to the same host, reusing connection
+ * \param[in]       arg: User argument
+ */
+void
+netconn_client_pool_thread(void const* arg) {
+    static netconn_client_pool_t pool;
+    uint32_t time;
+    espr_t res;
+
+    if (netconn_client_pool_init(&pool) != espOK) {
+        printf("Cannot create client pool\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    for (size_t i = 0; i < 5; i++) {
+        time = esp_sys_now();
+        res = netconn_client_pool_http_get(&pool);
+        printf("Request %d finished with %d in %d ms\r\n", (int)i, (int)res, (int)(esp_sys_now() - time));
+    }
+    printf("Pool hits: %d, misses: %d, evictions: %d\r\n", (int)pool.hits, (int)pool.misses, (int)pool.evictions);
+    netconn_client_pool_deinit(&pool);
+    esp_sys_thread_terminate(NULL);
+}
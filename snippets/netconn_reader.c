@@ -0,0 +1,87 @@
+/*
+ * Netconn reader copies received data directly to user buffer.
+ *
+ * Application does not need to walk and free pbufs returned by esp_netconn_receive.
+ * Reader copies as many bytes as fit to user buffer, keeps remainder
+ * for next call and frees pbuf once it has been fully consumed.
+ *
+ * Read is partial, similar to socket recv function: it blocks only
+ * when there are no pending data and returns whatever is available up to requested length.
+ * Position in received chain is kept in pbuf cursor, so partial reads
+ * continue from current pbuf instead of walking chain from its head.
+ */
+#include "netconn_reader.h"
+
+/**
+ * \brief           Initialize reader for netconn
+ * \param[in]       r: Reader handle to initialize
+ * \param[in]       nc: Netconn handle to read from
+ */
+void
+netconn_reader_init(netconn_reader_t* r, esp_netconn_p nc) {
+    r->nc = nc;
+    r->p = NULL;
+    pbuf_cursor_init(&r->c, NULL, 0);
+}
+
+/**
+ * \brief           Read data from netconn to user buffer
+ *
+ *                  When reader has pending data, they are returned immediately without waiting.
+ *                  Otherwise function blocks until new packet is received,
+ *                  or receive timeout set with \ref esp_netconn_set_receive_timeout expires
+ *
+ * \param[in]       r: Reader handle
+ * \param[out]      data: Output buffer to copy data to
+ * \param[in]       len: Size of output buffer in units of bytes
+ * \param[out]      br: Output variable to save number of bytes copied to buffer
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+netconn_reader_read(netconn_reader_t* r, void* data, size_t len, size_t* br) {
+    espr_t res;
+
+    *br = 0;
+    if (len == 0) {
+        return espOK;
+    }
+    if (r->p == NULL) {                         /* Wait for new data */
+        if ((res = esp_netconn_receive(r->nc, &r->p)) != espOK) {
+            r->p = NULL;
+            return res;
+        }
+        pbuf_cursor_init(&r->c, r->p, 0);
+    }
+
+    /* Copy pending data, cursor continues where previous read stopped */
+    *br = pbuf_cursor_read(&r->c, data, len);
+    if (pbuf_cursor_eof(&r->c)) {               /* Fully consumed? */
+        esp_pbuf_free(r->p);
+        r->p = NULL;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Get number of bytes received but not read yet
+ * \param[in]       r: Reader handle
+ * \return          Number of pending bytes
+ */
+size_t
+netconn_reader_pending(const netconn_reader_t* r) {
+    return r->p != NULL ? esp_pbuf_length(r->p, 1) - pbuf_cursor_pos(&r->c) : 0;
+}
+
+/**
+ * \brief           Drop pending data and free memory
+ * \note            Function does not close or delete netconn
+ * \param[in]       r: Reader handle
+ */
+void
+netconn_reader_free(netconn_reader_t* r) {
+    if (r->p != NULL) {
+        esp_pbuf_free(r->p);
+        r->p = NULL;
+    }
+    pbuf_cursor_init(&r->c, NULL, 0);
+}
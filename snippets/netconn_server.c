@@ -3,13 +3,19 @@
  * which listens for new connections and accepts them.
  *
  * When a new client is accepted by server,
- * separate thread for client is created where 
+ * it is passed to one of pre-created worker threads where
  * data is read, processed and send back to user
  */
 #include "netconn_server.h"
+#include "pbuf_cursor.h"
+#include "pbuf_chain.h"
+#include "netconn_server_pool.h"
 #include "esp/esp.h"
 
-static void netconn_server_processing_thread(void* const arg);
+#define NETCONN_SERVER_WORKERS          2
+#define NETCONN_SERVER_QUEUE_LEN        4
+
+static void netconn_server_process_client(esp_netconn_p client, void* arg);
 
 /**
  * \brief           Main page response file
@@ -47,84 +53,74 @@ resp_data_style[] = ""
 "\r\n"
 "body { color: red; font-family: Tahoma, Arial; };";
 
+/**
+ * \brief           Check if end of HTTP headers has been received
+ *
+ *                  Function is called for every received pbuf and keeps
+ *                  state between calls, so that `CRLFCRLF` split between
+ *                  `2` packets is detected too
+ *
+ * \param[in]       pbuf: Newly received pbuf
+ * \param[in,out]   state: Number of matched bytes of `CRLFCRLF` sequence
+ * \return          `1` if end of headers was found, `0` otherwise
+ */
+static uint8_t
+netconn_server_headers_done(esp_pbuf_p pbuf, uint8_t* state) {
+    pbuf_cursor_t c;
+    uint8_t ch;
+
+    pbuf_cursor_init(&c, pbuf, 0);
+    while (pbuf_cursor_next(&c, &ch)) {
+        if (ch == ((*state & 0x01) ? '\n' : '\r')) {
+            if (++(*state) == 4) {
+                return 1;
+            }
+        } else {
+            *state = ch == '\r' ? 1 : 0;
+        }
+    }
+    return 0;
+}
+
 /**
  * \brief           Netconn server thread implementation
  * \param[in]       arg: User argument
  */
 void
 netconn_server_thread(void const* arg) {
+    static netconn_server_pool_t pool;
     espr_t res;
-    esp_netconn_p server, client;
-                                                
+
     /*
-     * First create a new instance of netconn 
-     * connection and initialize system message boxes
-     * to accept clients and packet buffers
+     * Create workers, bind to port 80 and accept clients.
+     *
+     * Function blocks current thread and returns only on error.
+     * Accepted clients are processed by one of pre-created workers,
+     * when all are busy and work queue is full, client is closed immediately
      */
-    server = esp_netconn_new(ESP_NETCONN_TYPE_TCP);
-    if (server != NULL) {
-        printf("Server netconn created\r\n");
-        /*
-         * Bind network connection to port 80
-         */
-        res = esp_netconn_bind(server, 80);
-        if (res == espOK) {
-            printf("Server netconn listens on port 80\r\n");
-            /*
-             * Start listening for incoming connections
-             * on previously binded port
-             */
-            res = esp_netconn_listen(server);
-            
-            while (1) {
-                /*
-                 * Wait and accept new client connection
-                 * 
-                 * Function will block thread until 
-                 * new client is connected to server
-                 */
-                res = esp_netconn_accept(server, &client);
-                if (res == espOK) {
-                    printf("Netconn new client connected. Starting new thread...\r\n");
-                    /*
-                     * Start new thread for this request.
-                     *
-                     * Read and write back data to user in separated thread
-                     * to allow processing of multiple requests at the same time
-                     */
-                    if (esp_sys_thread_create(NULL, "client", (esp_sys_thread_fn)netconn_server_processing_thread, client, 512, ESP_SYS_THREAD_PRIO)) {
-                        printf("Netconn client thread created\r\n");
-                    } else {
-                        printf("Netconn client thread creation failed!\r\n");
-                    }
-                } else {
-                    printf("Netconn connection accept error!\r\n");
-                    break;
-                }
-            }
-        } else {
-            printf("Netconn server cannot bind to port\r\n");
-        }
-    } else {
-        printf("Cannot create server netconn\r\n");
-    }
-    
-    esp_netconn_delete(server);                 /* Delete netconn structure */
+    printf("Netconn server pool listens on port 80\r\n");
+    res = netconn_server_pool_run(&pool, 80, NETCONN_SERVER_WORKERS, NETCONN_SERVER_QUEUE_LEN, 512, netconn_server_process_client, NULL);
+    printf("Netconn server pool stopped: %d\r\n", (int)res);
     esp_sys_thread_terminate(NULL);             /* Terminate current thread */
 }
 
 /**
- * \brief           Thread to process single active connection
- * \param[in]       arg: Thread argument
+ * \brief           Process single active connection
+ * \note            Function is called from pool worker thread
+ * \param[in]       client: Accepted client
+ * \param[in]       arg: User argument
  */
 static void
-netconn_server_processing_thread(void* const arg) {
-    esp_netconn_p client;
-    esp_pbuf_p pbuf, p = NULL;
+netconn_server_process_client(esp_netconn_p client, void* arg) {
+    esp_pbuf_p pbuf;
     espr_t res;
-    char strt[20];
+    pbuf_chain_t ch;
+    pbuf_cursor_t c;
+    uint8_t hdr_state = 0;
+    char strt[20], req_line[32];
 
-    client = arg;                               /* Client handle is passed to argument */
+    ESP_UNUSED(arg);
+    pbuf_chain_init(&ch);                       /* Received packets are collected here */
                                                 
     printf("A new connection accepted!\r\n");   /* Print simple message */
                     
@@ -142,13 +138,13 @@ netconn_server_processing_thread(void* const arg) {
             /*
              * Check if all headers were received
              */
-            if (p == NULL) {
-                p = pbuf;                       /* Set as first buffer */
-            } else {
-                esp_pbuf_cat(p, pbuf);          /* Concatenate buffers together */
-            }
-            if (esp_pbuf_strfind(pbuf, "\r\n\r\n", 0) != ESP_SIZET_MAX) {
-                if (esp_pbuf_strfind(pbuf, "GET / ", 0) != ESP_SIZET_MAX) {
+            pbuf_chain_append(&ch, pbuf);
+            if (netconn_server_headers_done(pbuf, &hdr_state)) {
+                /* Read request line from the beginning of chain */
+                pbuf_cursor_init(&c, pbuf_chain_get(&ch), 0);
+                req_line[pbuf_cursor_read_until(&c, '\n', req_line, sizeof(req_line) - 1, NULL)] = 0;
+
+                if (!strncmp(req_line, "GET / ", 6)) {
                     uint32_t now;
                     printf("Main page request\r\n");
                     now = esp_sys_now();        /* Get current time */
@@ -156,22 +152,15 @@ netconn_server_processing_thread(void* const arg) {
                     esp_netconn_write(client, resp_data_mainpage_top, sizeof(resp_data_mainpage_top) - 1);
                     esp_netconn_write(client, strt, strlen(strt));
                     esp_netconn_write(client, resp_data_mainpage_bottom, sizeof(resp_data_mainpage_bottom) - 1);
-                } else if (esp_pbuf_strfind(pbuf, "GET /style.css ", 0) != ESP_SIZET_MAX) {
+                } else if (!strncmp(req_line, "GET /style.css ", 15)) {
                     printf("Style page request\r\n");
                     esp_netconn_write(client, resp_data_style, sizeof(resp_data_style) - 1);
                 } 
                 esp_netconn_close(client);      /* Close netconn connection */
-                esp_pbuf_free(p);               /* Do not forget to free memory after usage! */
-                p = NULL;
                 break;
             }
         }
     } while (res == espOK);
 
-    if (p != NULL) {                            /* Free received data */
-        esp_pbuf_free(p);
-        p = NULL;
-    }
-    esp_netconn_delete(client);                 /* Destroy client memory */
-    esp_sys_thread_terminate(NULL);             /* Terminate this thread */
+    pbuf_chain_free(&ch);                       /* Free received data, client is deleted by pool */
 }
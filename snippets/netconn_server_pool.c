@@ -0,0 +1,197 @@
+/*
+ * Netconn server pool accepts clients in caller thread
+ * and processes them in fixed number of pre-created worker threads.
+ *
+ * There is no thread creation per client. Accepted clients are put to bounded work queue,
+ * when queue is full, client is closed immediately and counted as rejected.
+ */
+#include "netconn_server_pool.h"
+#include "esp/esp_mem.h"
+
+/**
+ * \brief           Worker thread, processing clients from work queue
+ * \param[in]       arg: Pool handle
+ */
+static void
+netconn_server_pool_worker(void* const arg) {
+    netconn_server_pool_t* pool = arg;
+    netconn_server_pool_job_t job;
+    uint32_t wait;
+    uint8_t last;
+    void* msg;
+
+    while (1) {
+        esp_sys_mbox_get(&pool->queue, &msg, 0);
+        if (msg == NULL) {                      /* Pool is shutting down */
+            break;
+        }
+
+        esp_sys_protect();
+        job = *(netconn_server_pool_job_t *)msg;/* Copy job and release slot */
+        ((netconn_server_pool_job_t *)msg)->client = NULL;
+        pool->jobs_used--;
+        wait = esp_sys_now() - job.time;
+        pool->stats.wait_total += wait;
+        if (wait > pool->stats.wait_max) {
+            pool->stats.wait_max = wait;
+        }
+        esp_sys_unprotect();
+
+        pool->fn(job.client, pool->arg);        /* Process client */
+        if (esp_conn_is_active(esp_netconn_get_conn(job.client))) {
+            esp_netconn_close(job.client);      /* Function returned on error path, close link on device */
+        }
+        esp_netconn_delete(job.client);
+
+        esp_sys_protect();
+        pool->stats.served++;
+        esp_sys_unprotect();
+    }
+    esp_sys_protect();
+    last = --pool->workers_running == 0;
+    esp_sys_unprotect();
+    if (last) {
+        esp_sys_sem_release(&pool->done);       /* Binary semaphore, released by last worker only */
+    }
+    esp_sys_thread_terminate(NULL);
+}
+
+/**
+ * \brief           Start server pool and accept clients in current thread
+ *
+ *                  Function returns only if server cannot be started or accept fails
+ *
+ * \param[in]       pool: Pool handle
+ * \param[in]       port: Port to listen on
+ * \param[in]       workers: Number of worker threads
+ * \param[in]       queue_len: Maximal number of accepted clients waiting for worker
+ * \param[in]       stack_size: Stack size of every worker thread
+ * \param[in]       fn: Client processing function
+ * \param[in]       arg: User argument for processing function
+ * \return          Member of \ref espr_t enumeration
+ */
+espr_t
+netconn_server_pool_run(netconn_server_pool_t* pool, esp_port_t port, size_t workers, size_t queue_len,
+                        size_t stack_size, netconn_server_pool_fn fn, void* arg) {
+    netconn_server_pool_job_t* job;
+    esp_netconn_p client;
+    size_t started = 0;
+    espr_t res = espERRMEM;
+
+    memset(pool, 0x00, sizeof(*pool));
+    pool->fn = fn;
+    pool->arg = arg;
+    esp_sys_mbox_invalid(&pool->queue);
+    esp_sys_sem_invalid(&pool->done);
+
+    /*
+     * Slot is released by worker once job is copied from it.
+     * Slot is taken only when queue has space, therefore free slot always exists
+     */
+    pool->jobs_len = queue_len;
+    pool->jobs = esp_mem_alloc(pool->jobs_len * sizeof(*pool->jobs));
+    if (pool->jobs != NULL) {
+        memset(pool->jobs, 0x00, pool->jobs_len * sizeof(*pool->jobs));
+    }
+    if (pool->jobs == NULL
+        || !esp_sys_mbox_create(&pool->queue, queue_len)
+        || !esp_sys_sem_create(&pool->done, 0)) {
+        goto out;
+    }
+
+    /* Create workers */
+    for (; started < workers; started++) {
+        esp_sys_protect();
+        pool->workers_running++;
+        esp_sys_unprotect();
+        if (!esp_sys_thread_create(NULL, "pool_worker", (esp_sys_thread_fn)netconn_server_pool_worker, pool, stack_size, ESP_SYS_THREAD_PRIO)) {
+            esp_sys_protect();
+            pool->workers_running--;
+            esp_sys_unprotect();
+            break;
+        }
+    }
+    if (started == 0) {
+        goto out;
+    }
+
+    /* Create server */
+    if ((pool->server = esp_netconn_new(ESP_NETCONN_TYPE_TCP)) == NULL) {
+        goto out;
+    }
+    if ((res = esp_netconn_bind(pool->server, port)) == espOK) {
+        res = esp_netconn_listen(pool->server);
+    }
+
+    while (res == espOK) {
+        if ((res = esp_netconn_accept(pool->server, &client)) != espOK) {
+            break;
+        }
+        job = NULL;
+        esp_sys_protect();
+        if (pool->jobs_used < pool->jobs_len) {
+            while (pool->jobs[pool->jobs_w].client != NULL) {
+                pool->jobs_w = (pool->jobs_w + 1) % pool->jobs_len;
+            }
+            job = &pool->jobs[pool->jobs_w];
+            job->client = client;
+            job->time = esp_sys_now();
+            pool->jobs_used++;
+        }
+        esp_sys_unprotect();
+
+        if (job != NULL && esp_sys_mbox_putnow(&pool->queue, job)) {
+            esp_sys_protect();
+            pool->stats.accepted++;
+            esp_sys_unprotect();
+        } else {                                /* All workers busy and queue is full */
+            esp_sys_protect();
+            if (job != NULL) {
+                job->client = NULL;             /* Release slot, it was not put to queue */
+                pool->jobs_used--;
+            }
+            pool->stats.rejected++;
+            esp_sys_unprotect();
+            esp_netconn_close(client);
+            esp_netconn_delete(client);
+        }
+    }
+
+out:
+    /* Stop workers and wait for them to exit */
+    for (size_t i = 0; i < started; i++) {
+        esp_sys_mbox_put(&pool->queue, NULL);
+    }
+    if (started > 0) {
+        esp_sys_sem_wait(&pool->done, 0);       /* Last worker has exited */
+    }
+    if (pool->server != NULL) {
+        esp_netconn_delete(pool->server);
+        pool->server = NULL;
+    }
+    if (esp_sys_mbox_isvalid(&pool->queue)) {
+        esp_sys_mbox_delete(&pool->queue);
+        esp_sys_mbox_invalid(&pool->queue);
+    }
+    if (esp_sys_sem_isvalid(&pool->done)) {
+        esp_sys_sem_delete(&pool->done);
+        esp_sys_sem_invalid(&pool->done);
+    }
+    if (pool->jobs != NULL) {
+        esp_mem_free(pool->jobs);
+        pool->jobs = NULL;
+    }
+    return res == espOK ? espERR : res;
+}
+
+/**
+ * \brief           Get copy of pool statistics
+ * \param[in]       pool: Pool handle
+ * \param[out]      stats: Output variable to copy statistics to
+ */
+void
+netconn_server_pool_get_stats(netconn_server_pool_t* pool, netconn_server_pool_stats_t* stats) {
+    esp_sys_protect();
+    *stats = pool->stats;
+    esp_sys_unprotect();
+}
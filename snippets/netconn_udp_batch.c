@@ -0,0 +1,183 @@
+/*
+ * Batched datagram send and receive on UDP netconn.
+ *
+ * Send batch queues every datagram to producer thread without waiting for its result,
+ * so commands for next datagrams are already queued while previous one is being sent.
+ * Only last datagram is sent in blocking mode. Commands are processed in order,
+ * therefore when last one completes, all previous ones have completed too.
+ *
+ * When datagram cannot be queued without waiting, it and all remaining datagrams
+ * are sent in blocking mode. First blocking send which is processed by the library,
+ * successfully or not, confirms all queued datagrams have completed, no other command is used for that.
+ * Blocking send fails before it is queued only with \ref espERRMEM, such send is retried.
+ *
+ * Result of pipelined datagrams is not collected, netconn owns connection events.
+ * Batch only reports queueing errors and result of datagrams sent in blocking mode,
+ * datagram reported with `SEND FAIL` in the middle of batch is counted as sent.
+ *
+ * Receive batch waits for first datagram and then collects
+ * all datagrams already received, without waiting for new ones.
+ *
+ * Library public API does not expose source address of every received pbuf.
+ * Address saved for received datagram is remote address of netconn connection,
+ * which matches datagram source only when UDP netconn communicates with single peer.
+ */
+#include "netconn_udp_batch.h"
+
+/**
+ * \brief           Send multiple datagrams with single call
+ *
+ *                  Memory of all datagrams may be reused once function returns,
+ *                  unless it returns \ref espTIMEOUT. Function does not return while any queued datagram is still in progress.
+ *                  Only queueing errors and result of datagrams sent in blocking mode are reported,
+ *                  `SEND FAIL` of pipelined datagram is not detected
+ *
+ * \param[in]       nc: UDP netconn handle
+ * \param[in]       d: Array of datagrams to send
+ * \param[in]       cnt: Number of datagrams in array
+ * \param[out]      sent: Optional output variable to save number of datagrams processed before failed one
+ * \return          \ref espOK on success, \ref espTIMEOUT when blocking send could not be queued
+ *                      within \ref NETCONN_UDP_BATCH_SEND_RETRIES tries and memory of queued datagrams must stay valid,
+ *                      member of \ref espr_t otherwise
+ */
+espr_t
+netconn_udp_sendto_batch(esp_netconn_p nc, const netconn_udp_tx_t* d, size_t cnt, size_t* sent) {
+    esp_conn_p conn;
+    espr_t res = espOK;
+    size_t i, queued = 0;
+    uint8_t blocking = 0;
+
+    conn = esp_netconn_get_conn(nc);
+    for (i = 0; i < cnt && res == espOK; i++) {
+        /* Pipeline all but last datagram, last one waits for all of them */
+        if (!blocking && i + 1 < cnt
+            && esp_conn_sendto(conn, &d[i].ip, d[i].port, d[i].data, d[i].len, NULL, 0) == espOK) {
+            queued++;
+            continue;
+        }
+        blocking = 1;                           /* Last datagram or queue is full, send rest of batch in blocking mode */
+        for (size_t t = 0; ; t++) {
+            res = esp_conn_sendto(conn, &d[i].ip, d[i].port, d[i].data, d[i].len, NULL, 1);
+            if (res != espERRMEM || queued == 0) {
+                queued = 0;                     /* Processed send confirms all previous datagrams, or none is queued */
+                break;
+            }
+            if (t + 1 == NETCONN_UDP_BATCH_SEND_RETRIES) {
+                res = espTIMEOUT;               /* Queued datagrams may still be in progress */
+                break;
+            }
+            esp_delay(10);                      /* Not queued, memory of queued datagrams is still used */
+        }
+    }
+    if (res != espOK) {
+        i--;                                    /* Last datagram was not sent */
+    }
+    if (sent != NULL) {
+        *sent = i;
+    }
+    return res;
+}
+
+/**
+ * \brief           Receive multiple datagrams with single call
+ *
+ *                  Function blocks until first datagram is received, respecting netconn receive timeout.
+ *                  Other datagrams are returned only if they have already been received.
+ *                  Receive timeout of netconn is shortened while collecting them
+ *                  and restored before function returns,
+ *                  netconn shall not be received from other threads at the same time
+ *
+ * \note            Saved address is remote address of netconn connection, not of every datagram
+ * \param[in]       nc: UDP netconn handle
+ * \param[out]      d: Array to save received datagrams to
+ * \param[in]       cnt: Number of entries in array
+ * \param[out]      res: Optional output variable to save result of first receive operation,
+ *                      such as \ref espTIMEOUT or \ref espCLOSED
+ * \return          Number of received datagrams
+ */
+size_t
+netconn_udp_recvfrom_batch(esp_netconn_p nc, netconn_udp_rx_t* d, size_t cnt, espr_t* res) {
+    esp_conn_p conn;
+    esp_pbuf_p p;
+    espr_t r = espOK;
+    size_t i = 0;
+#if ESP_CFG_NETCONN_RECEIVE_TIMEOUT
+    uint32_t timeout;
+
+    timeout = esp_netconn_get_receive_timeout(nc);
+#endif /* ESP_CFG_NETCONN_RECEIVE_TIMEOUT */
+
+    conn = esp_netconn_get_conn(nc);
+    while (i < cnt) {
+        if ((r = esp_netconn_receive(nc, &p)) != espOK) {
+            break;
+        }
+        d[i].p = p;
+        esp_conn_get_remote_ip(conn, &d[i].ip);
+        d[i].port = esp_conn_get_remote_port(conn);
+        i++;
+#if ESP_CFG_NETCONN_RECEIVE_TIMEOUT
+        if (i == 1) {                           /* Do not wait for next datagrams */
+            esp_netconn_set_receive_timeout(nc, 1);
+        }
+#else
+        break;
+#endif /* !ESP_CFG_NETCONN_RECEIVE_TIMEOUT */
+    }
+
+    if (i > 0) {
+#if ESP_CFG_NETCONN_RECEIVE_TIMEOUT
+        esp_netconn_set_receive_timeout(nc, timeout);   /* Restore user timeout */
+#endif /* ESP_CFG_NETCONN_RECEIVE_TIMEOUT */
+        r = espOK;                              /* Timeout of following datagrams is not an error */
+    }
+    if (res != NULL) {
+        *res = r;
+    }
+    return i;
+}
+
+/**
+ * \brief           UDP echo on link connected to port 10000, datagrams are received and sent back in batches
+ * \param[in]       arg: User argument
+ */
+void
+netconn_udp_batch_thread(void const* arg) {
+    static netconn_udp_rx_t rx[8];
+    static netconn_udp_tx_t tx[8];
+    esp_netconn_p nc;
+    size_t cnt, len, sent;
+    espr_t res;
+
+    if ((nc = esp_netconn_new(ESP_NETCONN_TYPE_UDP)) == NULL) {
+        printf("Cannot create UDP netconn\r\n");
+        esp_sys_thread_terminate(NULL);
+        return;
+    }
+    /* Bind only saves port, UDP link on device is opened by connect */
+    if (esp_netconn_connect(nc, "192.168.0.14", 10000) == espOK) {
+        printf("UDP netconn connected to 192.168.0.14:10000\r\n");
+        while (1) {
+            cnt = netconn_udp_recvfrom_batch(nc, rx, ESP_ARRAYSIZE(rx), NULL);
+            for (size_t i = 0; i < cnt; i++) {
+                tx[i].ip = rx[i].ip;
+                tx[i].port = rx[i].port;
+                tx[i].data = esp_pbuf_get_linear_addr(rx[i].p, 0, &len);
+                tx[i].len = len;                /* First pbuf only, datagram is short */
+            }
+            if ((res = netconn_udp_sendto_batch(nc, tx, cnt, &sent)) != espOK) {
+                printf("UDP batch sent %d of %d datagrams: %d\r\n", (int)sent, (int)cnt, (int)res);
+                if (res == espTIMEOUT) {
+                    esp_delay(1000);            /* Queued sends not confirmed, give them time before memory is freed */
+                }
+            }
+            for (size_t i = 0; i < cnt; i++) {  /* No send is in progress anymore */
+                esp_pbuf_free(rx[i].p);
+            }
+        }
+    } else {
+        printf("UDP netconn cannot connect\r\n");
+    }
+    esp_netconn_delete(nc);
+    esp_sys_thread_terminate(NULL);
+}
@@ -0,0 +1,253 @@
+/*
+ * Pbuf chain head for appending received packets without walking the chain.
+ *
+ * esp_pbuf_cat walks to the end of the chain and updates total length
+ * of every pbuf on each call, which makes accumulating N packets O(N^2).
+ *
+ * Chain head keeps appended pbufs unlinked in a pointer array.
+ * First PBUF_CHAIN_SEGS pointers are stored in chain head itself,
+ * array is moved to heap and doubled in size when more packets are appended.
+ * Append is amortized O(1) and never walks any pbuf.
+ *
+ * Pending pbufs are linked only when chain is requested by user or freed,
+ * from the last one to the first one with esp_pbuf_cat,
+ * so every call only walks single appended packet. Linking is O(N) in total.
+ * If chain was already requested before, existing chain is walked once more.
+ * If array cannot grow because of missing memory,
+ * pending pbufs are linked immediately and append falls back to walking the chain.
+ *
+ * Only public pbuf API is used. Pending pbufs have valid total length of their own packet,
+ * linked chain has valid total length at any time.
+ * Reference counter semantics are the same as with esp_pbuf_cat and esp_pbuf_chain.
+ */
+#include "pbuf_chain.h"
+#include "esp/esp_mem.h"
+
+/**
+ * \brief           Get array of pending pbufs
+ * \param[in]       ch: Chain head
+ * \return          Pointer to first pending pbuf entry
+ */
+static esp_pbuf_p*
+pbuf_chain_segs(pbuf_chain_t* ch) {
+    return ch->segs != NULL ? ch->segs : ch->segs_buf;
+}
+
+/**
+ * \brief           Link pending pbufs to the end of chain
+ * \param[in]       ch: Chain head
+ */
+static void
+pbuf_chain_link(pbuf_chain_t* ch) {
+    esp_pbuf_p* segs = pbuf_chain_segs(ch);
+    size_t i;
+
+    if (ch->segs_cnt == 0) {
+        return;
+    }
+    for (i = ch->segs_cnt - 1; i > 0; i--) {
+        esp_pbuf_cat(segs[i - 1], segs[i]);     /* Walks only pbufs of single packet */
+    }
+    if (ch->head == NULL) {
+        ch->head = segs[0];
+    } else {
+        esp_pbuf_cat(ch->head, segs[0]);        /* Walks chain linked by previous request */
+    }
+    ch->segs_cnt = 0;
+}
+
+/**
+ * \brief           Make room for one more pending pbuf
+ * \param[in]       ch: Chain head
+ * \return          `1` on success, `0` when memory could not be allocated
+ */
+static uint8_t
+pbuf_chain_grow(pbuf_chain_t* ch) {
+    esp_pbuf_p* segs;
+    size_t size;
+
+    if (ch->segs_cnt < PBUF_CHAIN_SEGS || ch->segs_cnt < ch->segs_size) {
+        return 1;
+    }
+    size = ch->segs_size > 0 ? 2 * ch->segs_size : 2 * PBUF_CHAIN_SEGS;
+    if ((segs = esp_mem_alloc(size * sizeof(*segs))) == NULL) {
+        return 0;
+    }
+    memcpy(segs, pbuf_chain_segs(ch), ch->segs_cnt * sizeof(*segs));
+    if (ch->segs != NULL) {
+        esp_mem_free(ch->segs);
+    }
+    ch->segs = segs;
+    ch->segs_size = size;
+    return 1;
+}
+
+/**
+ * \brief           Initialize chain head
+ * \param[in]       ch: Chain head to initialize
+ */
+void
+pbuf_chain_init(pbuf_chain_t* ch) {
+    memset(ch, 0x00, sizeof(*ch));
+}
+
+/**
+ * \brief           Append pbuf to end of chain
+ *
+ *                  Ownership of pbuf is passed to chain, the same way as with \ref esp_pbuf_cat.
+ *                  User must not use or free `p` variable after the call.
+ *                  Function cannot fail. When pending array cannot grow,
+ *                  pbuf is linked to chain immediately
+ *
+ * \param[in]       ch: Chain head
+ * \param[in]       p: Pbuf or chain of pbufs to append, `NULL` is ignored
+ */
+void
+pbuf_chain_append(pbuf_chain_t* ch, esp_pbuf_p p) {
+    if (p == NULL) {
+        return;
+    }
+    if (!pbuf_chain_grow(ch)) {
+        pbuf_chain_link(ch);                    /* Out of memory, walk the chain instead */
+    }
+    pbuf_chain_segs(ch)[ch->segs_cnt++] = p;
+    ch->tot_len += esp_pbuf_length(p, 1);
+    ch->cnt++;
+}
+
+/**
+ * \brief           Append pbuf to end of chain and keep user reference valid
+ *
+ *                  Reference counter of pbuf is increased, the same way as with \ref esp_pbuf_chain.
+ *                  User must still free `p` variable when it is not used anymore
+ *
+ * \param[in]       ch: Chain head
+ * \param[in]       p: Pbuf or chain of pbufs to append, `NULL` is ignored
+ */
+void
+pbuf_chain_append_ref(pbuf_chain_t* ch, esp_pbuf_p p) {
+    if (p == NULL) {
+        return;
+    }
+    esp_pbuf_ref(p);
+    pbuf_chain_append(ch, p);
+}
+
+/**
+ * \brief           Get first pbuf in a chain
+ *
+ *                  Chain head remains owner of returned chain.
+ *                  Pending pbufs are linked first, call this function once all data have been received
+ *
+ * \param[in]       ch: Chain head
+ * \return          First pbuf in a chain or `NULL` if chain is empty
+ */
+esp_pbuf_p
+pbuf_chain_get(pbuf_chain_t* ch) {
+    pbuf_chain_link(ch);
+    return ch->head;
+}
+
+/**
+ * \brief           Link all appended pbufs and take chain ownership from chain head
+ *
+ *                  Chain head is empty after the call.
+ *                  User must free returned chain with \ref esp_pbuf_free
+ *
+ * \param[in]       ch: Chain head
+ * \return          First pbuf in a chain or `NULL` if chain is empty
+ */
+esp_pbuf_p
+pbuf_chain_take(pbuf_chain_t* ch) {
+    esp_pbuf_p p;
+
+    p = pbuf_chain_get(ch);
+    if (ch->segs != NULL) {
+        esp_mem_free(ch->segs);
+    }
+    pbuf_chain_init(ch);
+    return p;
+}
+
+/**
+ * \brief           Get total length of all appended pbufs
+ * \param[in]       ch: Chain head
+ * \return          Total length in units of bytes
+ */
+size_t
+pbuf_chain_length(const pbuf_chain_t* ch) {
+    return ch->tot_len;
+}
+
+/**
+ * \brief           Get number of appended pbufs
+ * \param[in]       ch: Chain head
+ * \return          Number of pbufs
+ */
+size_t
+pbuf_chain_count(const pbuf_chain_t* ch) {
+    return ch->cnt;
+}
+
+/**
+ * \brief           Free all appended pbufs and reset chain head
+ * \param[in]       ch: Chain head
+ */
+void
+pbuf_chain_free(pbuf_chain_t* ch) {
+    esp_pbuf_p p;
+
+    if ((p = pbuf_chain_take(ch)) != NULL) {
+        esp_pbuf_free(p);
+    }
+}
+
+/**
+ * \brief           Compare appending time of esp_pbuf_cat and pbuf chain head
+ *
+ *                  Results are printed to debug output
+ *
+ * \param[in]       count: Number of segments to append, for example `1000`
+ * \param[in]       seg_len: Length of each segment in units of bytes
+ */
+void
+pbuf_chain_benchmark(size_t count, size_t seg_len) {
+    pbuf_chain_t ch;
+    esp_pbuf_p head = NULL, p;
+    uint32_t time;
+    size_t i;
+
+    /* Append with esp_pbuf_cat to the head of chain */
+    time = esp_sys_now();
+    for (i = 0; i < count; i++) {
+        if ((p = esp_pbuf_new(seg_len)) == NULL) {
+            break;
+        }
+        if (head == NULL) {
+            head = p;
+        } else {
+            esp_pbuf_cat(head, p);
+        }
+    }
+    time = esp_sys_now() - time;
+    printf("esp_pbuf_cat: %d segments, %d bytes in %d ms\r\n",
+        (int)i, (int)esp_pbuf_length(head, 1), (int)time);
+    if (head != NULL) {
+        esp_pbuf_free(head);
+    }
+
+    /* Append with chain head and link at the end */
+    pbuf_chain_init(&ch);
+    time = esp_sys_now();
+    for (i = 0; i < count; i++) {
+        if ((p = esp_pbuf_new(seg_len)) == NULL) {
+            break;
+        }
+        pbuf_chain_append(&ch, p);
+    }
+    head = pbuf_chain_get(&ch);
+    time = esp_sys_now() - time;
+    printf("pbuf_chain_append: %d segments, %d bytes in %d ms\r\n",
+        (int)i, (int)esp_pbuf_length(head, 1), (int)time);
+    pbuf_chain_free(&ch);
+}
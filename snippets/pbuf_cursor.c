@@ -0,0 +1,218 @@
+/*
+ * Pbuf cursor is sequential reader for chain of packet buffers.
+ *
+ * Reading chain with esp_pbuf_get_linear_addr or esp_pbuf_get_at
+ * starts from chain head on every call, which makes parsing of
+ * N segments O(N^2). Cursor keeps pointer to current pbuf and offset
+ * inside it, therefore every operation continues where previous one stopped.
+ *
+ * Cursor does not take reference on pbuf chain,
+ * user must keep chain valid for the time cursor is used.
+ */
+#include "pbuf_cursor.h"
+
+/**
+ * \brief           Move cursor to next pbuf if current one has been fully read
+ * \param[in]       c: Cursor handle
+ */
+static void
+pbuf_cursor_normalize(pbuf_cursor_t* c) {
+    if (c->rem == 0) {
+        c->p = NULL;
+    } else if (c->p != NULL && c->off >= esp_pbuf_length(c->p, 0)) {
+        c->p = esp_pbuf_skip(c->p, c->off, &c->off);
+    }
+}
+
+/**
+ * \brief           Advance cursor for number of bytes inside current pbuf
+ * \param[in]       c: Cursor handle
+ * \param[in]       len: Number of bytes to advance, must not exceed current span length
+ */
+static void
+pbuf_cursor_advance(pbuf_cursor_t* c, size_t len) {
+    c->off += len;
+    c->pos += len;
+    c->rem -= len;
+    pbuf_cursor_normalize(c);
+}
+
+/**
+ * \brief           Initialize cursor on pbuf chain
+ * \param[in]       c: Cursor handle to initialize
+ * \param[in]       p: First pbuf in a chain
+ * \param[in]       offset: Start offset from beginning of chain
+ */
+void
+pbuf_cursor_init(pbuf_cursor_t* c, esp_pbuf_p p, size_t offset) {
+    pbuf_cursor_init_range(c, p, offset, ESP_SIZET_MAX);
+}
+
+/**
+ * \brief           Initialize cursor on part of pbuf chain
+ * \param[in]       c: Cursor handle to initialize
+ * \param[in]       p: First pbuf in a chain
+ * \param[in]       offset: Start offset from beginning of chain
+ * \param[in]       len: Maximal number of bytes cursor may read from start offset
+ */
+void
+pbuf_cursor_init_range(pbuf_cursor_t* c, esp_pbuf_p p, size_t offset, size_t len) {
+    c->pos = offset;
+    c->off = 0;
+    c->rem = len;
+    c->p = esp_pbuf_skip(p, offset, &c->off);
+    pbuf_cursor_normalize(c);
+}
+
+/**
+ * \brief           Get absolute cursor position from beginning of chain
+ * \param[in]       c: Cursor handle
+ * \return          Cursor position in units of bytes
+ */
+size_t
+pbuf_cursor_pos(const pbuf_cursor_t* c) {
+    return c->pos;
+}
+
+/**
+ * \brief           Check if cursor reached end of chain
+ * \param[in]       c: Cursor handle
+ * \return          `1` if there are no more bytes to read, `0` otherwise
+ */
+uint8_t
+pbuf_cursor_eof(const pbuf_cursor_t* c) {
+    return c->p == NULL;
+}
+
+/**
+ * \brief           Read byte at cursor position without moving cursor
+ * \param[in]       c: Cursor handle
+ * \param[out]      el: Output variable to save byte to
+ * \return          `1` on success, `0` if cursor is at the end of chain
+ */
+uint8_t
+pbuf_cursor_peek(const pbuf_cursor_t* c, uint8_t* el) {
+    if (c->p == NULL) {
+        return 0;
+    }
+    *el = ((const uint8_t *)esp_pbuf_data(c->p))[c->off];
+    return 1;
+}
+
+/**
+ * \brief           Read byte at cursor position and move cursor for one byte
+ * \param[in]       c: Cursor handle
+ * \param[out]      el: Output variable to save byte to
+ * \return          `1` on success, `0` if cursor is at the end of chain
+ */
+uint8_t
+pbuf_cursor_next(pbuf_cursor_t* c, uint8_t* el) {
+    if (!pbuf_cursor_peek(c, el)) {
+        return 0;
+    }
+    pbuf_cursor_advance(c, 1);
+    return 1;
+}
+
+/**
+ * \brief           Get linear memory at cursor position
+ *
+ *                  Function does not move cursor. Use \ref pbuf_cursor_skip
+ *                  with returned length to continue with next span
+ *
+ * \param[in]       c: Cursor handle
+ * \param[out]      len: Output variable to save number of linear bytes at returned address
+ * \return          Pointer to data at cursor position or `NULL` if cursor is at the end of chain
+ */
+const void*
+pbuf_cursor_span(pbuf_cursor_t* c, size_t* len) {
+    if (c->p == NULL) {
+        *len = 0;
+        return NULL;
+    }
+    *len = ESP_MIN(esp_pbuf_length(c->p, 0) - c->off, c->rem);
+    return (const uint8_t *)esp_pbuf_data(c->p) + c->off;
+}
+
+/**
+ * \brief           Move cursor forward
+ * \param[in]       c: Cursor handle
+ * \param[in]       len: Number of bytes to skip
+ * \return          Number of bytes actually skipped
+ */
+size_t
+pbuf_cursor_skip(pbuf_cursor_t* c, size_t len) {
+    size_t span, n, skipped = 0;
+
+    while (skipped < len && pbuf_cursor_span(c, &span) != NULL) {
+        n = ESP_MIN(span, len - skipped);
+        pbuf_cursor_advance(c, n);
+        skipped += n;
+    }
+    return skipped;
+}
+
+/**
+ * \brief           Copy data from chain at cursor position and move cursor
+ * \param[in]       c: Cursor handle
+ * \param[out]      data: Output memory to copy data to
+ * \param[in]       len: Maximal number of bytes to copy
+ * \return          Number of bytes copied
+ */
+size_t
+pbuf_cursor_read(pbuf_cursor_t* c, void* data, size_t len) {
+    const void* d;
+    size_t span, n, copied = 0;
+
+    while (copied < len && (d = pbuf_cursor_span(c, &span)) != NULL) {
+        n = ESP_MIN(span, len - copied);
+        memcpy((uint8_t *)data + copied, d, n);
+        pbuf_cursor_advance(c, n);
+        copied += n;
+    }
+    return copied;
+}
+
+/**
+ * \brief           Copy data from chain until delimiter is found
+ *
+ *                  Delimiter is consumed by cursor but it is not copied to output buffer.
+ *                  When output buffer is full before delimiter is found,
+ *                  cursor stops at first byte which did not fit to buffer
+ *
+ * \param[in]       c: Cursor handle
+ * \param[in]       delim: Delimiter byte to stop at
+ * \param[out]      data: Output memory to copy data to. Set to `NULL` to only skip the data
+ * \param[in]       len: Size of output memory in units of bytes
+ * \param[out]      found: Optional output variable, set to `1` if delimiter was found or `0` otherwise
+ * \return          Number of bytes copied to output memory
+ */
+size_t
+pbuf_cursor_read_until(pbuf_cursor_t* c, uint8_t delim, void* data, size_t len, uint8_t* found) {
+    const uint8_t *d, *end;
+    size_t span, n, copied = 0;
+    uint8_t f = 0;
+
+    while (copied < len && (d = pbuf_cursor_span(c, &span)) != NULL) {
+        end = memchr(d, delim, span);
+        n = end != NULL ? ESP_SZ(end - d) : span;
+        if (n > len - copied) {                 /* Delimiter does not fit to user buffer */
+            n = len - copied;
+            end = NULL;
+        }
+        if (data != NULL) {
+            memcpy((uint8_t *)data + copied, d, n);
+        }
+        copied += n;
+        if (end != NULL) {
+            pbuf_cursor_advance(c, n + 1);      /* Consume delimiter too */
+            f = 1;
+            break;
+        }
+        pbuf_cursor_advance(c, n);
+    }
+    if (found != NULL) {
+        *found = f;
+    }
+    return copied;
+}
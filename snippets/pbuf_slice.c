@@ -0,0 +1,170 @@
+/*
+ * Pbuf slice is zero-copy view to subrange of pbuf chain.
+ *
+ * Instead of copying "bytes 120..680" of received chain to new memory,
+ * slice references pbuf where range starts and shares its reference counter.
+ *
+ * Freeing pbuf chain stops at first pbuf with reference counter still above zero,
+ * therefore original owner may free its chain after slice is created.
+ * Pbufs before slice start are released immediately,
+ * pbufs with slice data are released when slice is freed.
+ */
+#include "pbuf_slice.h"
+#include "esp/esp_mem.h"
+
+/**
+ * \brief           Create slice of pbuf chain
+ * \note            Slice takes its own reference, original owner must still free its chain
+ * \param[out]      s: Slice handle to initialize
+ * \param[in]       p: Pbuf chain to create slice from
+ * \param[in]       offset: Start offset of slice in a chain
+ * \param[in]       len: Length of slice. It is trimmed to available length in a chain
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+pbuf_slice_init(pbuf_slice_p s, esp_pbuf_p p, size_t offset, size_t len) {
+    size_t tot;
+
+    memset(s, 0x00, sizeof(*s));
+    if (p == NULL) {
+        return espPARERR;
+    }
+    tot = esp_pbuf_length(p, 1);
+    if (offset > tot) {
+        return espPARERR;
+    }
+    len = ESP_MIN(len, tot - offset);
+
+    /* Find first pbuf with slice data and offset in it */
+    s->p = esp_pbuf_skip(p, offset, &s->off);
+    if (s->p == NULL) {                         /* Empty slice at the end of chain */
+        return espOK;
+    }
+    s->len = len;
+    return esp_pbuf_ref(s->p);
+}
+
+/**
+ * \brief           Create slice from another slice
+ * \param[out]      s: Slice handle to initialize
+ * \param[in]       from: Slice to create subrange from
+ * \param[in]       offset: Start offset relative to `from` slice
+ * \param[in]       len: Length of new slice. It is trimmed to length of `from` slice
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+pbuf_slice_sub(pbuf_slice_p s, const pbuf_slice_p from, size_t offset, size_t len) {
+    if (offset > from->len) {
+        memset(s, 0x00, sizeof(*s));
+        return espPARERR;
+    }
+    return pbuf_slice_init(s, from->p, from->off + offset, ESP_MIN(len, from->len - offset));
+}
+
+/**
+ * \brief           Release slice reference
+ * \param[in]       s: Slice handle
+ */
+void
+pbuf_slice_free(pbuf_slice_p s) {
+    if (s->p != NULL) {
+        esp_pbuf_free(s->p);
+    }
+    memset(s, 0x00, sizeof(*s));
+}
+
+/**
+ * \brief           Allocate new slice in memory
+ *
+ *                  Use this function when slice is passed to message queue
+ *                  or to another thread, and release it with \ref pbuf_slice_delete
+ *
+ * \param[in]       p: Pbuf chain to create slice from
+ * \param[in]       offset: Start offset of slice in a chain
+ * \param[in]       len: Length of slice
+ * \return          Slice handle on success, `NULL` otherwise
+ */
+pbuf_slice_p
+pbuf_slice_new(esp_pbuf_p p, size_t offset, size_t len) {
+    pbuf_slice_p s;
+
+    s = esp_mem_alloc(sizeof(*s));
+    if (s != NULL) {
+        if (pbuf_slice_init(s, p, offset, len) != espOK) {
+            esp_mem_free(s);
+            s = NULL;
+        }
+    }
+    return s;
+}
+
+/**
+ * \brief           Release slice reference and free memory allocated with \ref pbuf_slice_new
+ * \param[in]       s: Slice handle
+ */
+void
+pbuf_slice_delete(pbuf_slice_p s) {
+    if (s != NULL) {
+        pbuf_slice_free(s);
+        esp_mem_free(s);
+    }
+}
+
+/**
+ * \brief           Get length of slice
+ * \param[in]       s: Slice handle
+ * \return          Length in units of bytes
+ */
+size_t
+pbuf_slice_length(const pbuf_slice_p s) {
+    return s->len;
+}
+
+/**
+ * \brief           Copy slice data to linear memory
+ * \param[in]       s: Slice handle
+ * \param[out]      data: Memory to copy data to
+ * \param[in]       len: Maximal number of bytes to copy
+ * \param[in]       offset: Start offset relative to slice
+ * \return          Number of bytes copied
+ */
+size_t
+pbuf_slice_copy(const pbuf_slice_p s, void* data, size_t len, size_t offset) {
+    if (s->p == NULL || offset >= s->len) {
+        return 0;
+    }
+    return esp_pbuf_copy(s->p, data, ESP_MIN(len, s->len - offset), s->off + offset);
+}
+
+/**
+ * \brief           Get linear address of slice data at specific offset
+ * \param[in]       s: Slice handle
+ * \param[in]       offset: Offset relative to slice
+ * \param[out]      new_len: Number of linear bytes at returned address, trimmed to slice end
+ * \return          Pointer to data on success, `NULL` otherwise
+ */
+const void*
+pbuf_slice_get_linear_addr(const pbuf_slice_p s, size_t offset, size_t* new_len) {
+    const void* d;
+    size_t len = 0;
+
+    d = NULL;
+    if (s->p != NULL && offset < s->len) {
+        d = esp_pbuf_get_linear_addr(s->p, s->off + offset, &len);
+        len = ESP_MIN(len, s->len - offset);
+    }
+    if (new_len != NULL) {
+        *new_len = len;
+    }
+    return d;
+}
+
+/**
+ * \brief           Initialize cursor to read slice data sequentially
+ * \param[in]       s: Slice handle
+ * \param[out]      c: Cursor to initialize
+ */
+void
+pbuf_slice_cursor(const pbuf_slice_p s, pbuf_cursor_t* c) {
+    pbuf_cursor_init_range(c, s->p, s->off, s->len);
+}
@@ -0,0 +1,251 @@
+/*
+ * Chain-aware utilities for pbufs.
+ *
+ * Functions process every pbuf of a chain in place, using pbuf cursor spans,
+ * without copying chain to linear memory first with esp_pbuf_copy.
+ *
+ * CRC-32 uses ARMv8 CRC32 instructions when compiler reports them
+ * (__ARM_FEATURE_CRC32), otherwise 16-entry nibble table (64 bytes of flash)
+ * is used instead of common 1kB table, which is too big for small devices.
+ */
+#include "pbuf_util.h"
+#include "pbuf_cursor.h"
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif /* defined(__ARM_FEATURE_CRC32) */
+
+/**
+ * \brief           Check if any byte in a word is zero
+ */
+#define PBUF_UTIL_HAS_ZERO(v)           (((v) - 0x01010101UL) & ~(v) & 0x80808080UL)
+
+/**
+ * \brief           Find first byte in linear memory, processing 4 bytes at a time
+ * \param[in]       d: Linear memory
+ * \param[in]       len: Length of memory
+ * \param[in]       ch: Byte to search for
+ * \return          Position of byte or `len` if not found
+ */
+static size_t
+pbuf_util_memchr_span(const uint8_t* d, size_t len, uint8_t ch) {
+    uint32_t mask, w;
+    size_t i = 0;
+
+    /* Process bytes until aligned address */
+    for (; i < len && ((uintptr_t)(d + i) & 0x03) != 0; i++) {
+        if (d[i] == ch) {
+            return i;
+        }
+    }
+
+    /* Process aligned words, XOR with pattern results in zero byte on match */
+    mask = 0x01010101UL * ch;
+    for (; i + 4 <= len; i += 4) {
+        memcpy(&w, d + i, 4);
+        w ^= mask;
+        if (PBUF_UTIL_HAS_ZERO(w)) {
+            break;                              /* Byte is in this word */
+        }
+    }
+
+    /* Process remaining bytes */
+    for (; i < len; i++) {
+        if (d[i] == ch) {
+            return i;
+        }
+    }
+    return len;
+}
+
+#if !defined(__ARM_FEATURE_CRC32)
+/**
+ * \brief           CRC-32 (IEEE 802.3, reflected 0xEDB88320) lookup for 4-bit nibble
+ */
+static const uint32_t
+crc32_nibble_table[] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+#endif /* !defined(__ARM_FEATURE_CRC32) */
+
+/**
+ * \brief           Update raw CRC-32 value with linear memory
+ * \param[in]       crc: Current CRC value, not inverted
+ * \param[in]       d: Linear memory
+ * \param[in]       len: Length of memory
+ * \return          Updated CRC value
+ */
+static uint32_t
+pbuf_util_crc32_span(uint32_t crc, const uint8_t* d, size_t len) {
+#if defined(__ARM_FEATURE_CRC32)
+    uint32_t w;
+
+    for (; len > 0 && ((uintptr_t)d & 0x03) != 0; d++, len--) {
+        crc = __crc32b(crc, *d);
+    }
+    for (; len >= 4; d += 4, len -= 4) {
+        memcpy(&w, d, 4);
+        crc = __crc32w(crc, w);
+    }
+    for (; len > 0; d++, len--) {
+        crc = __crc32b(crc, *d);
+    }
+#else /* defined(__ARM_FEATURE_CRC32) */
+    for (; len > 0; d++, len--) {
+        crc ^= *d;
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+    }
+#endif /* !defined(__ARM_FEATURE_CRC32) */
+    return crc;
+}
+
+/**
+ * \brief           Compare part of pbuf chain with linear memory
+ * \param[in]       p: Pbuf chain
+ * \param[in]       offset: Start offset in a chain
+ * \param[in]       data: Memory to compare with
+ * \param[in]       len: Number of bytes to compare
+ * \return          `0` if equal, negative or positive value like `memcmp` otherwise.
+ *                  When chain is shorter than `len`, negative value is returned
+ */
+int
+pbuf_util_memcmp(const esp_pbuf_p p, size_t offset, const void* data, size_t len) {
+    pbuf_cursor_t c;
+    const void* d;
+    size_t span, done = 0;
+    int res;
+
+    pbuf_cursor_init_range(&c, p, offset, len);
+    while ((d = pbuf_cursor_span(&c, &span)) != NULL) {
+        if ((res = memcmp(d, (const uint8_t *)data + done, span)) != 0) {
+            return res;
+        }
+        done += span;
+        pbuf_cursor_skip(&c, span);
+    }
+    return done == len ? 0 : -1;
+}
+
+/**
+ * \brief           Find first occurrence of byte in part of pbuf chain
+ * \param[in]       p: Pbuf chain
+ * \param[in]       offset: Start offset in a chain
+ * \param[in]       len: Number of bytes to search. Use \ref ESP_SIZET_MAX to search to the end of chain
+ * \param[in]       ch: Byte to search for
+ * \return          Absolute position of byte in a chain or \ref ESP_SIZET_MAX if not found
+ */
+size_t
+pbuf_util_memchr(const esp_pbuf_p p, size_t offset, size_t len, uint8_t ch) {
+    pbuf_cursor_t c;
+    const void* d;
+    size_t span, pos;
+
+    pbuf_cursor_init_range(&c, p, offset, len);
+    while ((d = pbuf_cursor_span(&c, &span)) != NULL) {
+        if ((pos = pbuf_util_memchr_span(d, span, ch)) < span) {
+            return pbuf_cursor_pos(&c) + pos;
+        }
+        pbuf_cursor_skip(&c, span);
+    }
+    return ESP_SIZET_MAX;
+}
+
+/**
+ * \brief           Calculate CRC-32 (IEEE 802.3) of part of pbuf chain
+ *
+ *                  Result is compatible with zlib `crc32` function.
+ *                  Set `crc` to `0` on first call and to previous result
+ *                  to continue calculation over multiple chains
+ *
+ * \param[in]       p: Pbuf chain
+ * \param[in]       offset: Start offset in a chain
+ * \param[in]       len: Number of bytes. Use \ref ESP_SIZET_MAX to process to the end of chain
+ * \param[in]       crc: Previous CRC value or `0` on first call
+ * \return          CRC-32 value
+ */
+uint32_t
+pbuf_util_crc32(const esp_pbuf_p p, size_t offset, size_t len, uint32_t crc) {
+    pbuf_cursor_t c;
+    const void* d;
+    size_t span;
+
+    crc = ~crc;
+    pbuf_cursor_init_range(&c, p, offset, len);
+    while ((d = pbuf_cursor_span(&c, &span)) != NULL) {
+        crc = pbuf_util_crc32_span(crc, d, span);
+        pbuf_cursor_skip(&c, span);
+    }
+    return ~crc;
+}
+
+/**
+ * \brief           Calculate 32-bit FNV-1a hash of part of pbuf chain
+ *
+ *                  FNV-1a is serial over bytes by definition,
+ *                  only chain walk and copy are saved compared to linear buffer
+ *
+ * \param[in]       p: Pbuf chain
+ * \param[in]       offset: Start offset in a chain
+ * \param[in]       len: Number of bytes. Use \ref ESP_SIZET_MAX to process to the end of chain
+ * \param[in]       hash: \ref PBUF_UTIL_FNV1A_INIT on first call or previous result to continue
+ * \return          Hash value
+ */
+uint32_t
+pbuf_util_fnv1a(const esp_pbuf_p p, size_t offset, size_t len, uint32_t hash) {
+    pbuf_cursor_t c;
+    const uint8_t* d;
+    size_t span;
+
+    pbuf_cursor_init_range(&c, p, offset, len);
+    while ((d = pbuf_cursor_span(&c, &span)) != NULL) {
+        pbuf_cursor_skip(&c, span);
+        for (; span > 0; d++, span--) {
+            hash = (hash ^ *d) * 0x01000193UL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * \brief           Measure memory used by single pbuf on top of its payload
+ *
+ *                  Difference of free memory before and after \ref esp_pbuf_new
+ *                  includes pbuf header, memory manager block header and alignment
+ *
+ * \param[in]       len: Payload length in units of bytes
+ * \return          Overhead in units of bytes or `0` if pbuf cannot be allocated
+ */
+size_t
+pbuf_util_overhead(size_t len) {
+    esp_pbuf_p p;
+    size_t before, used = 0;
+
+    esp_sys_protect();                          /* Prevent processing thread from allocating meanwhile */
+    before = esp_mem_getfree();
+    if ((p = esp_pbuf_new(len)) != NULL) {
+        used = before - esp_mem_getfree();
+        esp_pbuf_free(p);
+    }
+    esp_sys_unprotect();
+    return used > len ? used - len : 0;
+}
+
+/**
+ * \brief           Print pbuf overhead for telnet keystroke, MQTT packet and full +IPD block
+ *
+ *                  Results are printed to debug output
+ */
+void
+pbuf_util_overhead_print(void) {
+    static const size_t lens[] = { 2, 64, ESP_CFG_IPD_MAX_BUFF_SIZE };
+    size_t i, ovh;
+
+    for (i = 0; i < ESP_ARRAYSIZE(lens); i++) {
+        ovh = pbuf_util_overhead(lens[i]);
+        printf("Pbuf payload: %5d bytes, overhead: %3d bytes, %3d%% of payload\r\n",
+            (int)lens[i], (int)ovh, (int)(ovh * 100 / lens[i]));
+    }
+}
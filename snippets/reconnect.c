@@ -0,0 +1,138 @@
+/*
+ * Reconnect policy spreads reconnection attempts of many devices in time.
+ *
+ * Delay after every failed attempt doubles, up to maximal value.
+ * Actual delay is random value between half and full of that,
+ * with generator seeded from device MAC address, so devices which lost
+ * connection at the same time do not reconnect in lockstep.
+ * Successful connection resets delay to its base value.
+ */
+#include "reconnect.h"
+
+/**
+ * \brief           Get next pseudo random number
+ * \param[in]       rc: Reconnect handle
+ * \return          Random number
+ */
+static uint32_t
+reconnect_rand(reconnect_t* rc) {
+    uint32_t x = rc->rand;
+
+    x ^= x << 13;                               /* Xorshift32 */
+    x ^= x >> 17;
+    x ^= x << 5;
+    rc->rand = x;
+    return x;
+}
+
+/**
+ * \brief           Initialize reconnect policy
+ * \param[in]       rc: Reconnect handle
+ * \param[in]       base: Delay after first failed attempt in units of milliseconds
+ * \param[in]       max: Maximal delay in units of milliseconds
+ * \param[in]       seed: Random seed. Set to `0` to use station MAC address and current time
+ */
+void
+reconnect_init(reconnect_t* rc, uint32_t base, uint32_t max, uint32_t seed) {
+    esp_mac_t mac;
+
+    memset(rc, 0x00, sizeof(*rc));
+    rc->base = ESP_MAX(base, 1);
+    rc->max = ESP_MAX(max, rc->base);
+    if (seed == 0) {
+        seed = esp_sys_now();
+        if (esp_sta_getmac(&mac, 0, NULL, NULL, 1) == espOK) {
+            for (size_t i = 0; i < sizeof(mac.mac); i++) {
+                seed = (seed ^ mac.mac[i]) * 0x01000193;    /* FNV-1a step */
+            }
+        }
+    }
+    rc->rand = seed != 0 ? seed : 0x2545F491;
+}
+
+/**
+ * \brief           Set callback function called after every successful connection
+ *
+ *                  Use it to subscribe to topics or restore other connection state
+ *
+ * \param[in]       rc: Reconnect handle
+ * \param[in]       fn: Callback function or `NULL` to disable it
+ * \param[in]       arg: User argument
+ */
+void
+reconnect_set_connected_fn(reconnect_t* rc, reconnect_fn fn, void* arg) {
+    rc->connected_fn = fn;
+    rc->connected_arg = arg;
+}
+
+/**
+ * \brief           Count failed attempt and get delay before next one
+ * \param[in]       rc: Reconnect handle
+ * \return          Delay in units of milliseconds
+ */
+uint32_t
+reconnect_next_delay(reconnect_t* rc) {
+    uint32_t delay = rc->base;
+
+    /* Double delay for every failed attempt, stop before overflow */
+    for (uint32_t i = 0; i < rc->attempts && delay < rc->max; i++) {
+        delay = delay > rc->max / 2 ? rc->max : delay * 2;
+    }
+    delay = ESP_MIN(delay, rc->max);
+    rc->attempts++;
+
+    /* Random delay between half and full value */
+    return delay / 2 + reconnect_rand(rc) % (delay - delay / 2 + 1);
+}
+
+/**
+ * \brief           Count failed attempt and block thread before next one
+ * \param[in]       rc: Reconnect handle
+ */
+void
+reconnect_wait(reconnect_t* rc) {
+    uint32_t delay = reconnect_next_delay(rc);
+
+    printf("Reconnect attempt %d in %d ms\r\n", (int)rc->attempts, (int)delay);
+    esp_delay(delay);
+}
+
+/**
+ * \brief           Report successful connection
+ *
+ *                  Resets delay to base value and calls connected callback
+ *
+ * \param[in]       rc: Reconnect handle
+ */
+void
+reconnect_success(reconnect_t* rc) {
+    rc->attempts = 0;
+    if (rc->connected_fn != NULL) {
+        rc->connected_fn(rc->connected_arg);
+    }
+}
+
+/**
+ * \brief           Connect netconn to remote host, retrying with backoff on failure
+ * \param[in]       rc: Reconnect handle
+ * \param[in]       nc: Netconn handle
+ * \param[in]       host: Remote host name or IP address
+ * \param[in]       port: Remote port
+ * \param[in]       max_attempts: Maximal number of attempts. Set to `0` to try until connected
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+reconnect_netconn_connect(reconnect_t* rc, esp_netconn_p nc, const char* host, esp_port_t port, uint32_t max_attempts) {
+    espr_t res = espERR;
+
+    for (uint32_t i = 0; max_attempts == 0 || i < max_attempts; i++) {
+        if (i > 0) {
+            reconnect_wait(rc);
+        }
+        if ((res = esp_netconn_connect(nc, host, port)) == espOK) {
+            reconnect_success(rc);
+            return espOK;
+        }
+    }
+    return res;
+}
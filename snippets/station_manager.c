@@ -1,4 +1,5 @@
 #include "station_manager.h"
+#include "evt_mux.h"
 #include "esp/esp.h"
 
 /*
@@ -186,6 +187,10 @@ access_points_cb(esp_evt_t* evt) {
  */
 void
 start_access_point_scan_and_connect_procedure(void) {
-    esp_evt_register(access_points_cb);         /* Register access points */
+    /* Register for access points and station events only */
+    evt_mux_register(access_points_cb,
+        EVT_MUX_MASK(ESP_EVT_STA_LIST_AP) | EVT_MUX_MASK(ESP_EVT_STA_JOIN_AP)
+        | EVT_MUX_MASK(ESP_EVT_WIFI_CONNECTED) | EVT_MUX_MASK(ESP_EVT_WIFI_GOT_IP)
+        | EVT_MUX_MASK(ESP_EVT_WIFI_DISCONNECTED));
     scan_access_points();                       /* Scan for access points */
 }
@@ -11,6 +11,7 @@
 #include "esp/esp_cli.h"
 #include "cli/cli.h"
 #include "cli/cli_input.h"
+#include "netconn_reader.h"
 
 static esp_netconn_p client;
 static bool close_conn = false;
@@ -170,8 +171,10 @@ telnet_command_sequence_check(char ch) {
 void
 telnet_server_thread(void const* arg) {
     espr_t res;
-    esp_pbuf_p pbuf;
     esp_netconn_p server;
+    netconn_reader_t reader;
+    uint8_t buff[64];
+    size_t len;
 
     /*
      * First create a new instance of netconn
@@ -232,22 +235,22 @@ telnet_server_thread(void const* arg) {
             break;
         }
 
+        netconn_reader_init(&reader, client);
         while (true) {
-            res = esp_netconn_receive(client, &pbuf);
+            res = netconn_reader_read(&reader, buff, sizeof(buff), &len);
             if (res == espCLOSED) {
                 break;
+            } else if (res != espOK) {
+                continue;                       /* Receive timeout, wait again */
             }
 
-            const uint8_t * in_data = esp_pbuf_data(pbuf);
-            size_t length = esp_pbuf_length(pbuf, 1); /* Get length of received packet */
-
-            for (int i = 0; i < length; i++) {
-                if (!telnet_command_sequence_check(in_data[i])) {
-                    cli_in_data(telnet_cli_printf, in_data[i]);
+            /* Process received data byte by byte */
+            for (size_t i = 0; i < len; i++) {
+                if (!telnet_command_sequence_check(buff[i])) {
+                    cli_in_data(telnet_cli_printf, buff[i]);
                 }
             }
 
-            esp_pbuf_free(pbuf);
             esp_netconn_flush(client);
 
             if (close_conn) {
@@ -256,6 +259,7 @@ telnet_server_thread(void const* arg) {
                 break;
             }
         }
+        netconn_reader_free(&reader);           /* Drop unread data */
         if (client != NULL) {
             esp_netconn_delete(client);         /* Delete netconn connection */
             client = NULL;
@@ -0,0 +1,269 @@
+/*
+ * Timer wheel runs any number of application timers on top of single esp_timeout.
+ *
+ * Timers are linked to slot of their absolute deadline, which makes arming and canceling O(1),
+ * regardless of number of pending timers. Slot may hold timers of later wheel turns,
+ * they stay linked until their deadline passes.
+ *
+ * Single esp_timeout is armed at earliest deadline of all timers,
+ * therefore processing thread sleeps until that deadline, even when it is
+ * many wheel turns away, instead of waking up on every tick or on every turn.
+ *
+ * Expired timers are moved to separate list and their callbacks are called
+ * one by one without protection. Callback may add or remove any timer,
+ * including expired ones still waiting for their callback.
+ */
+#include "timer_wheel.h"
+#include "esp/esp_timeout.h"
+
+static void timer_wheel_expired(void* arg);
+
+/**
+ * \brief           Timer wheel state
+ */
+static struct {
+    timer_wheel_timer_t* slots[TIMER_WHEEL_SLOTS];  /*!< List of timers for every slot */
+    timer_wheel_timer_t* expired;               /*!< List of expired timers waiting for callback */
+    uint32_t tick;                              /*!< Last processed tick, time in units of TIMER_WHEEL_TICK */
+    size_t cnt;                                 /*!< Number of active timers */
+    uint8_t armed;                              /*!< Set to `1` when esp_timeout is pending */
+    uint32_t armed_time;                        /*!< Time when pending esp_timeout expires */
+} tw;
+
+/**
+ * \brief           Arm esp_timeout for deadline if it is earlier than currently armed one
+ * \note            Function must be called with system protection
+ * \param[in]       deadline: Absolute time in units of milliseconds
+ * \param[in]       now: Current time
+ */
+static void
+timer_wheel_arm(uint32_t deadline, uint32_t now) {
+    if (tw.armed && (int32_t)(deadline - tw.armed_time) >= 0) {
+        return;                                 /* Armed timeout expires earlier */
+    }
+    if (tw.armed) {
+        esp_timeout_remove(timer_wheel_expired);
+    }
+    tw.armed = 1;
+    tw.armed_time = deadline;
+    esp_timeout_add((int32_t)(deadline - now) > 0 ? deadline - now : 0, timer_wheel_expired, NULL);
+}
+
+/**
+ * \brief           Unlink timer from its slot
+ * \note            Function must be called with system protection
+ * \param[in]       t: Timer to unlink
+ */
+static void
+timer_wheel_unlink(timer_wheel_timer_t* t) {
+    if (t->prev != NULL) {
+        t->prev->next = t->next;
+    } else {
+        tw.slots[t->slot] = t->next;
+    }
+    if (t->next != NULL) {
+        t->next->prev = t->prev;
+    }
+    t->next = t->prev = NULL;
+    t->active = 0;
+    tw.cnt--;
+}
+
+/**
+ * \brief           Link timer to expired list
+ * \note            Function must be called with system protection
+ * \param[in]       t: Timer unlinked from its slot
+ */
+static void
+timer_wheel_link_expired(timer_wheel_timer_t* t) {
+    t->prev = NULL;
+    t->next = tw.expired;
+    if (t->next != NULL) {
+        t->next->prev = t;
+    }
+    tw.expired = t;
+    t->expired = 1;
+}
+
+/**
+ * \brief           Unlink timer from expired list, its callback is not called anymore
+ * \note            Function must be called with system protection
+ * \param[in]       t: Timer to unlink
+ */
+static void
+timer_wheel_unlink_expired(timer_wheel_timer_t* t) {
+    if (t->prev != NULL) {
+        t->prev->next = t->next;
+    } else {
+        tw.expired = t->next;
+    }
+    if (t->next != NULL) {
+        t->next->prev = t->prev;
+    }
+    t->next = t->prev = NULL;
+    t->expired = 0;
+}
+
+/**
+ * \brief           Arm esp_timeout at earliest deadline of all timers
+ *
+ *                  Slots are checked in order from current tick, first slot with timer
+ *                  of current wheel turn holds earliest deadline. When all timers belong to later turns,
+ *                  earliest deadline found while checking the slots is used
+ *
+ * \note            Function must be called with system protection
+ * \param[in]       now: Current time
+ */
+static void
+timer_wheel_arm_next(uint32_t now) {
+    timer_wheel_timer_t* t;
+    uint32_t tick, min = 0;
+    uint8_t found = 0, in_slot;
+
+    tick = now / TIMER_WHEEL_TICK;
+    for (size_t d = 0; tw.cnt > 0 && d < TIMER_WHEEL_SLOTS; d++) {
+        in_slot = 0;
+        for (t = tw.slots[(tick + d) % TIMER_WHEEL_SLOTS]; t != NULL; t = t->next) {
+            if (!found || (int32_t)(t->deadline - min) < 0) {
+                min = t->deadline;
+                found = 1;
+                in_slot |= t->deadline / TIMER_WHEEL_TICK == tick + d;
+            }
+        }
+        if (in_slot) {
+            break;                              /* No later slot has earlier deadline */
+        }
+    }
+    if (found) {
+        timer_wheel_arm(min, now);
+    }
+}
+
+/**
+ * \brief           Timeout callback, expires all timers with deadline up to current time
+ * \param[in]       arg: Not used
+ */
+static void
+timer_wheel_expired(void* arg) {
+    timer_wheel_timer_t *t, *next;
+    timer_wheel_fn fn;
+    void* fn_arg;
+    uint32_t now, tick;
+    size_t cnt;
+
+    esp_sys_protect();
+    tw.armed = 0;
+    now = esp_sys_now();
+    tick = now / TIMER_WHEEL_TICK;
+
+    /* Check slots passed since last call, every slot at most once */
+    cnt = tick - tw.tick + 1;
+    if (cnt > TIMER_WHEEL_SLOTS) {
+        cnt = TIMER_WHEEL_SLOTS;
+    }
+    for (size_t i = 0; i < cnt && tw.cnt > 0; i++) {
+        for (t = tw.slots[(tick - i) % TIMER_WHEEL_SLOTS]; t != NULL; t = next) {
+            next = t->next;
+            if ((int32_t)(t->deadline - now) <= 0) {
+                timer_wheel_unlink(t);
+                timer_wheel_link_expired(t);    /* Collect to call outside of loop */
+            }
+        }
+    }
+    tw.tick = tick;
+
+    timer_wheel_arm_next(now);                  /* Sleep until next deadline */
+    esp_sys_unprotect();
+
+    /* Callbacks may add or remove timers, take one expired timer at a time */
+    while (1) {
+        esp_sys_protect();
+        if ((t = tw.expired) != NULL) {
+            timer_wheel_unlink_expired(t);
+            fn = t->fn;
+            fn_arg = t->arg;
+        }
+        esp_sys_unprotect();
+        if (t == NULL) {
+            break;
+        }
+        fn(fn_arg);
+    }
+    ESP_UNUSED(arg);
+}
+
+/**
+ * \brief           Start timer
+ *
+ *                  If timer is already active, it is restarted with new time
+ *
+ * \param[in]       t: Timer handle, must stay valid until timer expires or is removed
+ * \param[in]       time: Time in units of milliseconds after which callback is called
+ * \param[in]       fn: Callback function
+ * \param[in]       arg: User argument for callback function
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+espr_t
+timer_wheel_add(timer_wheel_timer_t* t, uint32_t time, timer_wheel_fn fn, void* arg) {
+    uint32_t now;
+
+    if (fn == NULL) {
+        return espPARERR;
+    }
+    esp_sys_protect();
+    if (t->active) {
+        timer_wheel_unlink(t);
+    } else if (t->expired) {
+        timer_wheel_unlink_expired(t);          /* Restarted before its callback was called */
+    }
+    now = esp_sys_now();
+    if (tw.cnt == 0) {                          /* Wheel is empty, nothing to process before now */
+        tw.tick = now / TIMER_WHEEL_TICK;
+    }
+
+    t->fn = fn;
+    t->arg = arg;
+    t->deadline = now + time;
+    t->slot = (t->deadline / TIMER_WHEEL_TICK) % TIMER_WHEEL_SLOTS;
+    t->prev = NULL;
+    t->next = tw.slots[t->slot];
+    if (t->next != NULL) {
+        t->next->prev = t;
+    }
+    tw.slots[t->slot] = t;
+    t->active = 1;
+    tw.cnt++;
+
+    timer_wheel_arm(t->deadline, now);
+    esp_sys_unprotect();
+    return espOK;
+}
+
+/**
+ * \brief           Stop timer
+ * \param[in]       t: Timer handle
+ */
+void
+timer_wheel_remove(timer_wheel_timer_t* t) {
+    esp_sys_protect();
+    if (t->active) {
+        timer_wheel_unlink(t);
+        if (tw.cnt == 0 && tw.armed) {          /* Nothing to wait for anymore */
+            esp_timeout_remove(timer_wheel_expired);
+            tw.armed = 0;
+        }
+    } else if (t->expired) {
+        timer_wheel_unlink_expired(t);          /* Expired, but callback was not called yet */
+    }
+    esp_sys_unprotect();
+}
+
+/**
+ * \brief           Check if timer is armed
+ * \param[in]       t: Timer handle
+ * \return          `1` if timer is armed, `0` otherwise
+ */
+uint8_t
+timer_wheel_is_active(const timer_wheel_timer_t* t) {
+    return t->active;
+}